@@ -0,0 +1,466 @@
+#include "AscTraceReplay.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // Splits the next whitespace separated token off [p, end).
+    bool nextToken(const char*& p, const char* end, const char*& tokenBegin, const char*& tokenEnd)
+    {
+        while (p < end && isSpace(*p))
+        {
+            ++p;
+        }
+        if (p == end)
+        {
+            return false;
+        }
+        tokenBegin = p;
+        while (p < end && !isSpace(*p))
+        {
+            ++p;
+        }
+        tokenEnd = p;
+        return true;
+    }
+
+    bool tokenIs(const char* begin, const char* end, const char* text)
+    {
+        size_t length = strlen(text);
+        return (size_t)(end - begin) == length && strncasecmp(begin, text, length) == 0;
+    }
+
+    int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool parseUnsigned(const char* begin, const char* end, int base, uint32_t& value)
+    {
+        if (begin == end)
+        {
+            return false;
+        }
+        value = 0;
+        for (const char* p = begin; p < end; ++p)
+        {
+            int digit = hexDigit(*p);
+            if (digit < 0 || digit >= base)
+            {
+                return false;
+            }
+            value = value * base + digit;
+        }
+        return true;
+    }
+
+    // "12.345678" seconds to nanoseconds, without going through a double.
+    bool parseTimestamp(const char* begin, const char* end, int64_t& ns)
+    {
+        int64_t seconds = 0, fraction = 0;
+        int fractionDigits = 0;
+        const char* p = begin;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            seconds = seconds * 10 + (*p - '0');
+        }
+        if (p == begin)
+        {
+            return false;
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                if (fractionDigits < 9)
+                {
+                    fraction = fraction * 10 + (*p - '0');
+                    ++fractionDigits;
+                }
+            }
+        }
+        if (p != end)
+        {
+            return false;
+        }
+        for (; fractionDigits < 9; ++fractionDigits)
+        {
+            fraction *= 10;
+        }
+        ns = seconds * 1000000000LL + fraction;
+        return true;
+    }
+
+    uint64_t pageSize()
+    {
+        static const uint64_t size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    // CAN FD data length code to payload length.
+    uint32_t dlcToLength(uint32_t dlc)
+    {
+        static const uint8_t lengths[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+        return dlc < 16 ? lengths[dlc] : 64;
+    }
+}
+
+AscTraceReplay::AscTraceReplay()
+    : m_fd(-1)
+    , m_fileSize(0)
+    , m_map(nullptr)
+    , m_mapOffset(0)
+    , m_mapLength(0)
+    , m_position(0)
+    , m_skippingLine(false)
+    , m_hexIds(true)
+    , m_relativeTimestamps(false)
+    , m_lastTimestampNs(0)
+    , m_pending()
+    , m_hasPending(false)
+    , m_framesRead(0)
+    , m_linesSkipped(0)
+{
+}
+
+AscTraceReplay::~AscTraceReplay()
+{
+    Close();
+}
+
+bool AscTraceReplay::Open(const std::string& path)
+{
+    Close();
+    m_errorDescription.clear();
+
+    m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+    if (m_fd < 0)
+    {
+        m_errorDescription = std::string("Cannot open trace ").append(path).append(": ").append(strerror(errno));
+        return false;
+    }
+    struct stat64 st;
+    if (fstat64(m_fd, &st) != 0)
+    {
+        m_errorDescription = std::string("Cannot stat trace ").append(path).append(": ").append(strerror(errno));
+        Close();
+        return false;
+    }
+    m_fileSize = static_cast<uint64_t>(st.st_size);
+    m_position = 0;
+    m_skippingLine = false;
+    m_hexIds = true;
+    m_relativeTimestamps = false;
+    m_lastTimestampNs = 0;
+    m_framesRead = 0;
+    m_linesSkipped = 0;
+
+    readNextFrame();
+    return m_errorDescription.empty();
+}
+
+void AscTraceReplay::Close()
+{
+    unmapWindow();
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_hasPending = false;
+}
+
+void AscTraceReplay::unmapWindow()
+{
+    if (m_map != nullptr)
+    {
+        munmap(const_cast<char*>(m_map), m_mapLength);
+        m_map = nullptr;
+        m_mapLength = 0;
+    }
+}
+
+bool AscTraceReplay::mapWindow(uint64_t offset)
+{
+    unmapWindow();
+
+    m_mapOffset = offset - offset % pageSize();
+    uint64_t remaining = m_fileSize - m_mapOffset;
+    m_mapLength = static_cast<size_t>(remaining < MAP_WINDOW_SIZE ? remaining : MAP_WINDOW_SIZE);
+    if (m_mapLength == 0)
+    {
+        return false;
+    }
+
+    void* map = mmap64(nullptr, m_mapLength, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off64_t>(m_mapOffset));
+    if (map == MAP_FAILED)
+    {
+        m_errorDescription = std::string("mmap of trace failed: ").append(strerror(errno));
+        m_mapLength = 0;
+        return false;
+    }
+    madvise(map, m_mapLength, MADV_SEQUENTIAL);
+    m_map = static_cast<const char*>(map);
+    return true;
+}
+
+// Returns the next line without its terminator. A line crossing the end of
+// the current window moves the window to start at that line.
+bool AscTraceReplay::nextLine(const char*& begin, const char*& end)
+{
+    while (m_position < m_fileSize)
+    {
+        if (m_map == nullptr || m_position < m_mapOffset || m_position >= m_mapOffset + m_mapLength)
+        {
+            if (!mapWindow(m_position))
+            {
+                return false;
+            }
+        }
+
+        const char* mapEnd = m_map + m_mapLength;
+        const char* lineBegin = m_map + (m_position - m_mapOffset);
+        const char* newline = static_cast<const char*>(memchr(lineBegin, '\n', mapEnd - lineBegin));
+        if (m_skippingLine)
+        {
+            // Rest of a line that did not fit into a window
+            m_position = newline != nullptr ? m_mapOffset + (newline - m_map) + 1 : m_mapOffset + m_mapLength;
+            m_skippingLine = newline == nullptr;
+            continue;
+        }
+        if (newline == nullptr && m_mapOffset + m_mapLength < m_fileSize)
+        {
+            if (m_position - m_mapOffset < pageSize())
+            {
+                // The window already starts at this line, it is no frame
+                m_skippingLine = true;
+                m_linesSkipped++;
+                m_position = m_mapOffset + m_mapLength;
+            }
+            else if (!mapWindow(m_position))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        begin = lineBegin;
+        end = newline != nullptr ? newline : mapEnd;
+        m_position += (end - begin) + (newline != nullptr ? 1 : 0);
+        return true;
+    }
+    return false;
+}
+
+void AscTraceReplay::parseHeader(const char* begin, const char* end)
+{
+    // "base hex  timestamps absolute"
+    const char* p = begin;
+    const char* tb;
+    const char* te;
+    while (nextToken(p, end, tb, te))
+    {
+        if (tokenIs(tb, te, "base") && nextToken(p, end, tb, te))
+        {
+            m_hexIds = !tokenIs(tb, te, "dec");
+        }
+        else if (tokenIs(tb, te, "timestamps") && nextToken(p, end, tb, te))
+        {
+            m_relativeTimestamps = tokenIs(tb, te, "relative");
+        }
+    }
+}
+
+// Classic:  <time> <ch> <id>[x] <Rx|Tx> d <dlc> <data...>   or   ... r [dlc]
+// CAN FD:   <time> CANFD <ch> <Rx|Tx> <id>[x] [name] <brs> <esi> <dlc> <length> <data...>
+bool AscTraceReplay::parseFrame(const char* begin, const char* end, CanFrame& msg)
+{
+    const char* p = begin;
+    const char* tb;
+    const char* te;
+    int64_t timestampNs;
+    if (!nextToken(p, end, tb, te) || !parseTimestamp(tb, te, timestampNs))
+    {
+        return false;
+    }
+    if (!nextToken(p, end, tb, te))
+    {
+        return false;
+    }
+
+    bool fd = tokenIs(tb, te, "CANFD");
+    if (fd && !nextToken(p, end, tb, te))
+    {
+        return false;
+    }
+    uint32_t channel;
+    if (!parseUnsigned(tb, te, 10, channel))
+    {
+        return false;
+    }
+
+    const char* idBegin;
+    const char* idEnd;
+    const char* dirBegin;
+    const char* dirEnd;
+    if (fd)
+    {
+        if (!nextToken(p, end, dirBegin, dirEnd) || !nextToken(p, end, idBegin, idEnd))
+        {
+            return false;
+        }
+    }
+    else if (!nextToken(p, end, idBegin, idEnd) || !nextToken(p, end, dirBegin, dirEnd))
+    {
+        return false;
+    }
+
+    bool extended = idEnd > idBegin && (idEnd[-1] == 'x' || idEnd[-1] == 'X');
+    uint32_t id;
+    if (!parseUnsigned(idBegin, extended ? idEnd - 1 : idEnd, m_hexIds ? 16 : 10, id))
+    {
+        return false;   // ErrorFrame, Statistic, ...
+    }
+    bool tx = tokenIs(dirBegin, dirEnd, "Tx");
+    if (!tx && !tokenIs(dirBegin, dirEnd, "Rx"))
+    {
+        return false;
+    }
+
+    memset(&msg, 0, sizeof(CanFrame));
+    msg.id = extended ? (id | CAN_EXTENDED_ID_FLAG) : id;
+    msg.channel = channel;
+    msg.direction = tx ? 1 : 0;
+    msg.type = 1;
+
+    uint32_t length = 0;
+    if (fd)
+    {
+        // The symbolic name is optional, BRS is always 0 or 1
+        if (!nextToken(p, end, tb, te))
+        {
+            return false;
+        }
+        if (!tokenIs(tb, te, "0") && !tokenIs(tb, te, "1") && !nextToken(p, end, tb, te))
+        {
+            return false;
+        }
+        uint32_t brs, esi, dlc;
+        if (!parseUnsigned(tb, te, 2, brs) ||
+            !nextToken(p, end, tb, te) || !parseUnsigned(tb, te, 2, esi) ||
+            !nextToken(p, end, tb, te) || !parseUnsigned(tb, te, 16, dlc) ||
+            !nextToken(p, end, tb, te) || !parseUnsigned(tb, te, 10, length))
+        {
+            return false;
+        }
+        msg.fdf = 1;
+        msg.brs = brs;
+        msg.esi = esi;
+        msg.dlc = dlc;
+        if (length > dlcToLength(dlc))
+        {
+            length = dlcToLength(dlc);
+        }
+    }
+    else
+    {
+        if (!nextToken(p, end, tb, te))
+        {
+            return false;
+        }
+        bool remote = tokenIs(tb, te, "r");
+        if (!remote && !tokenIs(tb, te, "d"))
+        {
+            return false;
+        }
+        uint32_t dlc = 0;
+        const char* dlcEnd = p;
+        if (nextToken(p, end, tb, te) && parseUnsigned(tb, te, 16, dlc))
+        {
+            msg.dlc = dlc;
+        }
+        else
+        {
+            p = dlcEnd;
+        }
+        msg.rtr = remote ? 1 : 0;
+        length = remote ? 0 : (dlc < 8 ? dlc : 8);
+    }
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        uint32_t byte;
+        if (!nextToken(p, end, tb, te) || !parseUnsigned(tb, te, 16, byte) || byte > 0xFF)
+        {
+            return false;
+        }
+        msg.Data()[i] = static_cast<unsigned char>(byte);
+    }
+
+    if (m_relativeTimestamps)
+    {
+        timestampNs += m_lastTimestampNs;
+    }
+    m_lastTimestampNs = timestampNs;
+    msg.timestamp_ns = timestampNs;
+    msg.length = static_cast<uint8_t>(length);
+    return true;
+}
+
+void AscTraceReplay::readNextFrame()
+{
+    m_hasPending = false;
+    const char* begin;
+    const char* end;
+    while (nextLine(begin, end))
+    {
+        const char* p = begin;
+        while (p < end && isSpace(*p))
+        {
+            ++p;
+        }
+        if (p == end)
+        {
+            continue;
+        }
+        if (*p < '0' || *p > '9')
+        {
+            if (end - p >= 4 && strncasecmp(p, "base", 4) == 0)
+            {
+                parseHeader(p, end);
+            }
+            continue;
+        }
+        if (parseFrame(p, end, m_pending.frame))
+        {
+            m_hasPending = true;
+            m_framesRead++;
+            return;
+        }
+        m_linesSkipped++;
+    }
+}
+
+size_t AscTraceReplay::CollectUntil(int64_t windowEndNs, CanFrameArena& frames)
+{
+    size_t added = 0;
+    while (m_hasPending && m_pending.frame.timestamp_ns < windowEndNs)
+    {
+        frames.Append(m_pending.frame);
+        ++added;
+        readNextFrame();
+    }
+    return added;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include "MockMessages.h"
+#include "CanFrameArena.h"
+
+// Replays the CAN and CAN FD frames of a Vector ASC trace.
+//
+// The trace is read through a sliding read-only mapping of MAP_WINDOW_SIZE
+// bytes, so traces of any size are parsed incrementally with a bounded
+// address space footprint (the harness is a 32-bit process). Frames are
+// handed out in timestamp order, one tick window at a time; lines that are
+// not frames (headers, error frames, statistics, ...) are skipped.
+class AscTraceReplay
+{
+public:
+    static const size_t MAP_WINDOW_SIZE = 16 * 1024 * 1024;
+
+    AscTraceReplay();
+    ~AscTraceReplay();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return m_fd >= 0; }
+    bool AtEnd() const { return !m_hasPending; }
+
+    // Appends every frame stamped before windowEndNs to frames and returns
+    // how many were added. Timestamps are nanoseconds of trace time.
+    size_t CollectUntil(int64_t windowEndNs, CanFrameArena& frames);
+
+    uint64_t FramesRead() const { return m_framesRead; }
+    uint64_t LinesSkipped() const { return m_linesSkipped; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    AscTraceReplay(const AscTraceReplay&);
+    AscTraceReplay& operator=(const AscTraceReplay&);
+
+    bool mapWindow(uint64_t offset);
+    void unmapWindow();
+    bool nextLine(const char*& begin, const char*& end);
+    void readNextFrame();
+    bool parseFrame(const char* begin, const char* end, CanFrame& msg);
+    void parseHeader(const char* begin, const char* end);
+
+    int m_fd;
+    uint64_t m_fileSize;
+    const char* m_map;
+    uint64_t m_mapOffset;
+    size_t m_mapLength;
+    uint64_t m_position;            // file offset of the next unread line
+    bool m_skippingLine;
+
+    bool m_hexIds;
+    bool m_relativeTimestamps;
+    int64_t m_lastTimestampNs;
+
+    CanFrameBuffer m_pending;       // next frame, read ahead of its window
+    bool m_hasPending;
+
+    uint64_t m_framesRead;
+    uint64_t m_linesSkipped;
+    std::string m_errorDescription;
+};
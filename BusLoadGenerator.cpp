@@ -0,0 +1,181 @@
+#include "BusLoadGenerator.h"
+#include "AscTraceReplay.h"
+#include <string.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const uint8_t dlcLengths[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+    // Payload length to CAN FD data length code, lengths between two codes
+    // are rounded up.
+    uint32_t lengthToDlc(uint32_t length)
+    {
+        uint32_t dlc = 0;
+        while (dlc < 15 && dlcLengths[dlc] < length)
+        {
+            ++dlc;
+        }
+        return dlc;
+    }
+
+    bool parsePattern(const std::string& text, BusLoadEntry& entry)
+    {
+        if (text == "counter")
+        {
+            entry.counterPattern = true;
+            return true;
+        }
+        if (text.empty() || text.size() % 2 != 0 || text.size() > 2 * sizeof(entry.payload))
+        {
+            return false;
+        }
+        size_t patternLength = text.size() / 2;
+        for (size_t i = 0; i < patternLength; ++i)
+        {
+            char* end;
+            std::string byte = text.substr(2 * i, 2);
+            entry.payload[i] = static_cast<unsigned char>(strtoul(byte.c_str(), &end, 16));
+            if (*end != '\0')
+            {
+                return false;
+            }
+        }
+        for (size_t i = patternLength; i < sizeof(entry.payload); ++i)
+        {
+            entry.payload[i] = entry.payload[i % patternLength];
+        }
+        return true;
+    }
+}
+
+BusLoadGenerator::BusLoadGenerator()
+    : m_framesEmitted(0)
+{
+}
+
+bool BusLoadGenerator::Load(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        m_errorDescription = std::string("Cannot open bus load config ").append(path);
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        std::string id, pattern;
+        double cycleMs, offsetMs;
+        BusLoadEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        if (!(fields >> id))
+        {
+            continue;
+        }
+
+        bool extended = id[id.size() - 1] == 'x' || id[id.size() - 1] == 'X';
+        char* end;
+        unsigned long value = strtoul(id.c_str(), &end, 0);
+        bool valid = end == id.c_str() + id.size() - (extended ? 1 : 0) &&
+            (fields >> entry.channel >> cycleMs >> offsetMs >> entry.length >> pattern) &&
+            cycleMs > 0 && offsetMs >= 0 && entry.length <= sizeof(entry.payload) &&
+            parsePattern(pattern, entry);
+        if (!valid)
+        {
+            std::ostringstream error;
+            error << path << ":" << lineNumber << ": expected <id>[x] <channel> <cycle ms> <offset ms> <length> <pattern>";
+            m_errorDescription = error.str();
+            return false;
+        }
+        entry.id = extended ? (static_cast<uint32_t>(value) | CAN_EXTENDED_ID_FLAG) : static_cast<uint32_t>(value);
+        entry.cycleNs = static_cast<int64_t>(cycleMs * 1e6);
+        entry.offsetNs = static_cast<int64_t>(offsetMs * 1e6);
+        Add(entry);
+    }
+    return true;
+}
+
+void BusLoadGenerator::Add(const BusLoadEntry& entry)
+{
+    m_entries.push_back(entry);
+}
+
+void BusLoadGenerator::Start(int64_t tickPeriodNs)
+{
+    m_wheel.Start(tickPeriodNs);
+    m_wheel.Reserve(m_entries.size());
+    m_framesEmitted = 0;
+
+    m_timers.assign(m_entries.size(), Timer());
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        m_timers[i].expiryNs = m_entries[i].offsetNs;
+        m_timers[i].counter = 0;
+        m_wheel.Schedule(static_cast<int32_t>(i), m_timers[i].expiryNs);
+    }
+}
+
+void BusLoadGenerator::emit(const BusLoadEntry& entry, Timer& timer, CanFrameArena& frames)
+{
+    // CAN FD lengths between two codes are padded with zeros up to the DLC
+    bool fd = entry.length > 8;
+    uint32_t dlc = fd ? lengthToDlc(entry.length) : entry.length;
+    CanFrame& msg = *frames.Append(fd ? dlcLengths[dlc] : entry.length);
+    msg.id = entry.id;
+    msg.channel = entry.channel;
+    msg.direction = 0;
+    msg.timestamp_ns = timer.expiryNs;
+    msg.type = 1;
+    msg.dlc = dlc;
+    if (fd)
+    {
+        msg.fdf = 1;
+        msg.brs = 1;
+    }
+    if (entry.counterPattern)
+    {
+        for (uint32_t j = 0; j < entry.length; ++j)
+        {
+            msg.Data()[j] = static_cast<unsigned char>(timer.counter + j);
+        }
+    }
+    else
+    {
+        memcpy(msg.Data(), entry.payload, entry.length);
+    }
+    timer.counter++;
+    m_framesEmitted++;
+}
+
+void BusLoadGenerator::CollectTick(CanFrameArena& frames)
+{
+    int64_t windowEndNs = static_cast<int64_t>(m_wheel.Tick() + 1) * m_wheel.TickPeriodNs();
+    for (int32_t entryIndex = m_wheel.PopDue(); entryIndex != TimingWheel::NO_ITEM; entryIndex = m_wheel.PopDue())
+    {
+        Timer& timer = m_timers[entryIndex];
+        if (timer.expiryNs < windowEndNs)
+        {
+            // Cycles shorter than a tick send several times per window
+            const BusLoadEntry& entry = m_entries[entryIndex];
+            do
+            {
+                emit(entry, timer, frames);
+                timer.expiryNs += entry.cycleNs;
+            } while (timer.expiryNs < windowEndNs);
+        }
+        m_wheel.Schedule(entryIndex, timer.expiryNs);
+    }
+    m_wheel.Advance();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MockMessages.h"
+#include "CanFrameArena.h"
+#include "TimingWheel.h"
+
+// One periodic frame of the synthetic bus load.
+struct BusLoadEntry
+{
+    uint32_t id;                // CAN_EXTENDED_ID_FLAG set for 29-bit IDs
+    uint32_t channel;
+    int64_t cycleNs;
+    int64_t offsetNs;
+    uint32_t length;            // payload bytes, > 8 sends CAN FD
+    bool counterPattern;        // payload byte j = counter + j
+    unsigned char payload[64];  // pattern, already repeated to length
+};
+
+// Emits periodic CAN/CAN FD frames on a TimingWheel keyed by entry index.
+//
+// Per tick only the due entries and one slot per cascaded level are touched,
+// so the cost does not grow with the number of configured IDs. Nothing is
+// allocated after Start().
+class BusLoadGenerator
+{
+public:
+    BusLoadGenerator();
+
+    // Config lines: <id>[x] <channel> <cycle ms> <offset ms> <length> <pattern>
+    // pattern is a hex byte string repeated over the payload, or "counter".
+    bool Load(const std::string& path);
+    void Add(const BusLoadEntry& entry);
+
+    void Start(int64_t tickPeriodNs);
+
+    // Appends the frames due in the current tick window and advances one tick.
+    void CollectTick(CanFrameArena& frames);
+
+    size_t EntryCount() const { return m_entries.size(); }
+    uint64_t FramesEmitted() const { return m_framesEmitted; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    struct Timer
+    {
+        int64_t expiryNs;
+        uint32_t counter;
+    };
+
+    void emit(const BusLoadEntry& entry, Timer& timer, CanFrameArena& frames);
+
+    std::vector<BusLoadEntry> m_entries;
+    std::vector<Timer> m_timers;
+    TimingWheel m_wheel;
+    uint64_t m_framesEmitted;
+    std::string m_errorDescription;
+};
@@ -0,0 +1,46 @@
+#include "CanFrameArena.h"
+#include <cstring>
+
+CanFrameArena::CanFrameArena(size_t capacity)
+    : m_storage((capacity + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+    , m_used(0)
+    , m_count(0)
+    , m_grows(0)
+{
+}
+
+CanFrame* CanFrameArena::Append(uint32_t length)
+{
+    if (length > CAN_MAX_PAYLOAD)
+    {
+        length = CAN_MAX_PAYLOAD;
+    }
+    size_t size = CanFrameSize(length);
+    if (m_used + size > Capacity())
+    {
+        size_t capacity = Capacity() > 0 ? Capacity() * 2 : DEFAULT_CAPACITY;
+        m_storage.resize(capacity / sizeof(uint64_t));
+        m_grows++;
+    }
+
+    CanFrame* frame = reinterpret_cast<CanFrame*>(reinterpret_cast<unsigned char*>(m_storage.data()) + m_used);
+    memset(frame, 0, size);
+    frame->length = static_cast<uint8_t>(length);
+    m_used += size;
+    m_count++;
+    return frame;
+}
+
+void CanFrameArena::Append(const CanFrame& frame)
+{
+    CanFrame* copy = Append(frame.length);
+    uint8_t length = copy->length;
+    memcpy(copy, &frame, sizeof(CanFrame) + length);
+    copy->length = length;
+}
+
+void CanFrameArena::Reset()
+{
+    m_used = 0;
+    m_count = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MockMessages.h"
+
+// Bump allocator for the CAN frames of one tick. Frames are appended back to
+// back in the packed CanFrame layout and the whole batch is dropped with one
+// Reset() per tick. The buffer only grows when a tick carries more frames
+// than any tick before, so steady-state injection does not touch the heap.
+class CanFrameArena
+{
+public:
+    static const size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+    explicit CanFrameArena(size_t capacity = DEFAULT_CAPACITY);
+
+    // Returns a zeroed frame with room for length payload bytes. The pointer
+    // is valid until the next Append() or Reset().
+    CanFrame* Append(uint32_t length);
+    // Copies a complete frame, header and payload, into the arena.
+    void Append(const CanFrame& frame);
+    void Reset();
+
+    const CanFrame* First() const { return reinterpret_cast<const CanFrame*>(m_storage.data()); }
+    size_t Count() const { return m_count; }
+    size_t Bytes() const { return m_used; }
+    size_t Capacity() const { return m_storage.size() * sizeof(uint64_t); }
+    uint64_t Grows() const { return m_grows; }
+
+private:
+    CanFrameArena(const CanFrameArena&);
+    CanFrameArena& operator=(const CanFrameArena&);
+
+    std::vector<uint64_t> m_storage;    // uint64_t keeps the frames 8 byte aligned
+    size_t m_used;
+    size_t m_count;
+    uint64_t m_grows;
+};
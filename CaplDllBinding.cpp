@@ -0,0 +1,135 @@
+#include "CaplDllBinding.h"
+#include <dlfcn.h>
+#include <cstring>
+#include "AsyncLogger.h"
+
+namespace
+{
+    // Candidate symbol names per entry point, mangled name first.
+    const char* const registerCDLLNames[] = { "VIARegisterCDLL", "_Z15VIARegisterCDLLP7VIACapl" };
+    const char* const appInitNames[] = { "_Z7appInitjPcjj", "appInit" };
+    const char* const setParamNames[] = { "_Z8SetParamjj", "SetParam" };
+    const char* const transactionNames[] = { "_Z21transactionofTxRxDataj", "transactionofTxRxData" };
+    const char* const setCanFrameNames[] = { "_Z11setCanFramejmmmxmmmmmmPh", "setCanFrame" };
+    const char* const setCanFramesNames[] = { "_Z12setCanFramesjPK8CanFramej", "setCanFrames" };
+    const char* const setEthFrameNames[] = { "_Z11setEthFramejmmxmPh", "setEthFrame" };
+    const char* const setEthFramesNames[] = { "_Z12setEthFramesjPKPK8EthFramej", "setEthFrames" };
+    const char* const setFlexrayFrameNames[] = { "_Z15setFlexrayFramejmmmxmPh", "setFlexrayFrame" };
+    const char* const setFlexrayFramesNames[] = { "_Z16setFlexrayFramesjPK12FlexrayFramej", "setFlexrayFrames" };
+    // declared extern "C" by VIA.h, the mangled name covers DLLs built without it
+    const char* const setServiceNames[] = { "VIASetService", "_Z13VIASetServiceP10VIAService" };
+
+    template <typename T, int N>
+    int countOf(T (&)[N]) { return N; }
+}
+
+CaplDllBinding::CaplDllBinding()
+    : m_handle(nullptr)
+    , m_isolated(false)
+{
+    memset(&m_functions, 0, sizeof(m_functions));
+}
+
+CaplDllBinding::~CaplDllBinding()
+{
+    Unload();
+}
+
+void* CaplDllBinding::resolve(const char* const names[], int count, bool required)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        void* symbol = dlsym(m_handle, names[i]);
+        if (symbol != nullptr)
+        {
+            return symbol;
+        }
+    }
+    if (!required)
+    {
+        return nullptr;
+    }
+    m_errorDescription.append(m_errorDescription.empty() ? "missing entry point " : ", ").append(names[0]);
+    return nullptr;
+}
+
+bool CaplDllBinding::Load(const std::string& path, bool isolated)
+{
+    Unload();
+    m_path = path;
+    m_isolated = isolated;
+    m_errorDescription.clear();
+
+    // RTLD_NOW makes unresolved references of the library fail here instead
+    // of in the middle of a tick.
+    if (isolated)
+    {
+        m_handle = dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    }
+    else
+    {
+        m_handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    }
+    if (m_handle == nullptr)
+    {
+        const char* error = dlerror();
+        m_errorDescription = std::string(isolated ? "dlmopen failed: " : "dlopen failed: ").append(error ? error : path);
+        return false;
+    }
+
+    m_functions.registerCDLL = (RegisterCDLLFunc)resolve(registerCDLLNames, countOf(registerCDLLNames));
+    m_functions.appInit = (InitializeFunc)resolve(appInitNames, countOf(appInitNames));
+    m_functions.setParam = (SetParamFunc)resolve(setParamNames, countOf(setParamNames));
+    m_functions.transactionofTxRxData = (transactionofTxRxDataFunc)resolve(transactionNames, countOf(transactionNames));
+    m_functions.setCanFrame = (SetCanFrameFunc)resolve(setCanFrameNames, countOf(setCanFrameNames));
+    m_functions.setCanFrames = (SetCanFramesFunc)resolve(setCanFramesNames, countOf(setCanFramesNames), false);
+    m_functions.setEthFrame = (SetEthFrameFunc)resolve(setEthFrameNames, countOf(setEthFrameNames), false);
+    m_functions.setEthFrames = (SetEthFramesFunc)resolve(setEthFramesNames, countOf(setEthFramesNames), false);
+    m_functions.setFlexrayFrame = (SetFlexrayFrameFunc)resolve(setFlexrayFrameNames, countOf(setFlexrayFrameNames), false);
+    m_functions.setFlexrayFrames = (SetFlexrayFramesFunc)resolve(setFlexrayFramesNames, countOf(setFlexrayFramesNames), false);
+    m_functions.setService = (SetServiceFunc)resolve(setServiceNames, countOf(setServiceNames), false);
+
+    if (!m_errorDescription.empty())
+    {
+        m_errorDescription.append(" in ").append(path);
+        std::string error = m_errorDescription;
+        Unload();
+        m_errorDescription = error;
+        return false;
+    }
+    return true;
+}
+
+void CaplDllBinding::Unload()
+{
+    memset(&m_functions, 0, sizeof(m_functions));
+    if (m_handle == nullptr)
+    {
+        return;
+    }
+    dlclose(m_handle);
+    m_handle = nullptr;
+    if (m_isolated)
+    {
+        // The namespace goes away with its last object, a reload always
+        // gets a fresh one.
+        return;
+    }
+
+    // A library that registered thread-locals or unique symbols stays mapped,
+    // a reload would then silently pick up the old code.
+    void* resident = dlopen(m_path.c_str(), RTLD_NOW | RTLD_NOLOAD);
+    if (resident != nullptr)
+    {
+        LOG_WARN(LOG_CAT_CAPL, "%s is still resident after unload, a reload reuses the old image", m_path.c_str());
+        dlclose(resident);
+    }
+}
+
+bool CaplDllBinding::Reload()
+{
+    std::string path = m_path;
+    bool isolated = m_isolated;
+    Unload();
+    return Load(path, isolated);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include "VIA.h"
+#include "VIA_CDLL.h"
+#include "MockMessages.h"
+
+typedef void (*RegisterCDLLFunc)(VIACapl *);
+typedef void (*InitializeFunc)(uint32 handle, char *ipaddress, uint32 port, uint32 ismaster);
+typedef void (*SetParamFunc)(uint32 handle, uint32 parameter);
+typedef void (*transactionofTxRxDataFunc)(uint32 handle);
+typedef void (*SetCanFrameFunc)( uint32 handle,unsigned long channel, unsigned long direction,unsigned long canid,
+                                long long timestamp,unsigned long type, unsigned long dlc, unsigned long rtr,
+                                unsigned long fdf, unsigned long brs, unsigned long esi, unsigned char payload[]);
+// frames are count packed CanFrame records, walked with CanFrameNext()
+typedef void (*SetCanFramesFunc)(uint32 handle, const CanFrame* frames, uint32 count);
+typedef void (*SetEthFrameFunc)(uint32 handle, unsigned long channel, unsigned long direction, long long timestamp,
+                                unsigned long length, unsigned char payload[]);
+typedef void (*SetEthFramesFunc)(uint32 handle, const EthFrame* const* frames, uint32 count);
+typedef void (*SetFlexrayFrameFunc)(uint32 handle, unsigned long channelMask, unsigned long slot, unsigned long cycle,
+                                    long long timestamp, unsigned long length, unsigned char payload[]);
+typedef void (*SetFlexrayFramesFunc)(uint32 handle, const FlexrayFrame* frames, uint32 count);
+typedef void (*SetServiceFunc)(VIAService* service);
+
+// Entry points of the CAPL DLL, resolved once when the library is loaded.
+struct CaplDllFunctions
+{
+    RegisterCDLLFunc registerCDLL;
+    InitializeFunc appInit;
+    SetParamFunc setParam;
+    transactionofTxRxDataFunc transactionofTxRxData;
+    SetCanFrameFunc setCanFrame;
+    SetCanFramesFunc setCanFrames;      // optional bulk entry point, may be null
+    SetEthFrameFunc setEthFrame;        // optional, needed for Ethernet injection
+    SetEthFramesFunc setEthFrames;      // optional bulk entry point, may be null
+    SetFlexrayFrameFunc setFlexrayFrame;        // optional, needed for FlexRay injection
+    SetFlexrayFramesFunc setFlexrayFrames;      // optional bulk entry point, may be null
+    SetServiceFunc setService;          // optional VIASetService, needed for timers
+};
+
+// Owns the dlopen handle of libcaplserver.so and its function table. Every
+// entry point is looked up under its C++ mangled name first and its
+// extern "C" name second; a library missing any of them is rejected as a
+// whole, so the callers never see a partially resolved table. Optional entry
+// points are left null when the library does not export them.
+//
+// An isolated binding loads the library into a link-map namespace of its own
+// (dlmopen), so several copies of the same library keep separate globals.
+// glibc caps the number of namespaces at 16, the main one included.
+class CaplDllBinding
+{
+public:
+    CaplDllBinding();
+    ~CaplDllBinding();
+
+    bool Load(const std::string& path, bool isolated = false);
+    void Unload();
+    // Unloads and loads the library from the same path again, e.g. after it
+    // was rebuilt. The old table is gone even if the new load fails.
+    bool Reload();
+
+    bool IsLoaded() const { return m_handle != nullptr; }
+    bool IsIsolated() const { return m_isolated; }
+    const CaplDllFunctions& Functions() const { return m_functions; }
+    const std::string& Path() const { return m_path; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    CaplDllBinding(const CaplDllBinding&);
+    CaplDllBinding& operator=(const CaplDllBinding&);
+
+    void* resolve(const char* const names[], int count, bool required = true);
+
+    void* m_handle;
+    bool m_isolated;
+    CaplDllFunctions m_functions;
+    std::string m_path;
+    std::string m_errorDescription;
+};
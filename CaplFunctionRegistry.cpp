@@ -0,0 +1,224 @@
+#include "CaplFunctionRegistry.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace
+{
+    // Allocations are rounded up to keep every object suitably aligned
+    const size_t ARENA_ALIGN = alignof(std::max_align_t);
+
+    size_t alignUp(size_t size)
+    {
+        return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    }
+
+    struct MoreExpensive
+    {
+        bool operator()(const MockCaplFunction* a, const MockCaplFunction* b) const
+        {
+            return a->stats.totalNs.load(std::memory_order_relaxed) > b->stats.totalNs.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+const int32_t CaplFunctionRegistry::NO_FUNCTION;
+const size_t CaplFunctionRegistry::BLOCK_SIZE;
+
+CaplFunctionRegistry::CaplFunctionRegistry()
+    : m_blockUsed(0)
+    , m_blockSize(0)
+{
+    Slot empty = { 0, NO_FUNCTION };
+    m_index.assign(16, empty);
+}
+
+CaplFunctionRegistry::~CaplFunctionRegistry()
+{
+    for (size_t i = 0; i < m_functions.size(); ++i)
+    {
+        m_functions[i]->~MockCaplFunction();
+    }
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+    {
+        delete[] m_blocks[i];
+    }
+}
+
+uint64_t CaplFunctionRegistry::hashName(const char* name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (; *name != '\0'; ++name)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Objects bigger than a block get a block of their own.
+void* CaplFunctionRegistry::allocate(size_t size)
+{
+    size = alignUp(size);
+    if (m_blocks.empty() || m_blockUsed + size > m_blockSize)
+    {
+        m_blockSize = std::max(size, BLOCK_SIZE);
+        m_blocks.push_back(new char[m_blockSize]);
+        m_blockUsed = 0;
+    }
+    void* memory = m_blocks.back() + m_blockUsed;
+    m_blockUsed += size;
+    return memory;
+}
+
+const char* CaplFunctionRegistry::intern(const char* name)
+{
+    size_t length = std::strlen(name) + 1;
+    char* copy = static_cast<char*>(allocate(length));
+    std::memcpy(copy, name, length);
+    return copy;
+}
+
+void CaplFunctionRegistry::add(MockCaplFunction* function)
+{
+    m_functions.push_back(function);
+    insert(hashName(function->name), function->id);
+}
+
+void CaplFunctionRegistry::insert(uint64_t hash, int32_t id)
+{
+    if ((m_functions.size() + 1) * 2 > m_index.size())
+    {
+        std::vector<Slot> old;
+        old.swap(m_index);
+        Slot empty = { 0, NO_FUNCTION };
+        m_index.assign(old.size() * 2, empty);
+        for (size_t j = 0; j < old.size(); ++j)
+        {
+            if (old[j].id != NO_FUNCTION)
+            {
+                insert(old[j].hash, old[j].id);
+            }
+        }
+    }
+    size_t mask = m_index.size() - 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (m_index[i].id != NO_FUNCTION)
+    {
+        i = (i + 1) & mask;
+    }
+    m_index[i].hash = hash;
+    m_index[i].id = id;
+}
+
+int32_t CaplFunctionRegistry::Find(const char* name) const
+{
+    if (name == nullptr)
+    {
+        return NO_FUNCTION;
+    }
+    uint64_t hash = hashName(name);
+    size_t mask = m_index.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; m_index[i].id != NO_FUNCTION; i = (i + 1) & mask)
+    {
+        if (m_index[i].hash == hash && std::strcmp(m_functions[m_index[i].id]->name, name) == 0)
+        {
+            return m_index[i].id;
+        }
+    }
+    return NO_FUNCTION;
+}
+
+MockCaplFunction* CaplFunctionRegistry::Acquire(const char* name)
+{
+    int32_t id = Find(name);
+    if (id == NO_FUNCTION)
+    {
+        return nullptr;
+    }
+    m_functions[id]->acquired.fetch_add(1, std::memory_order_relaxed);
+    return m_functions[id];
+}
+
+bool CaplFunctionRegistry::Release(VIACaplFunction* viaFunction)
+{
+    MockCaplFunction* function = static_cast<MockCaplFunction*>(viaFunction);
+    if (function == nullptr || function->id < 0 || static_cast<size_t>(function->id) >= m_functions.size() ||
+        m_functions[function->id] != function)
+    {
+        return false;
+    }
+    int32 acquired = function->acquired.load(std::memory_order_relaxed);
+    do
+    {
+        if (acquired <= 0)
+        {
+            return false;
+        }
+    }
+    while (!function->acquired.compare_exchange_weak(acquired, acquired - 1, std::memory_order_relaxed));
+    return true;
+}
+
+void CaplFunctionRegistry::ReleaseAll()
+{
+    for (size_t i = 0; i < m_functions.size(); ++i)
+    {
+        m_functions[i]->acquired.store(0, std::memory_order_relaxed);
+    }
+}
+
+void CaplFunctionRegistry::PrintStatistics(std::ostream& os, const std::string& prefix, uint64_t tickNs) const
+{
+    std::vector<const MockCaplFunction*> called;
+    for (size_t i = 0; i < m_functions.size(); ++i)
+    {
+        const CaplCallStats& stats = m_functions[i]->stats;
+        if (stats.calls.load(std::memory_order_relaxed) > 0 || stats.rejected.load(std::memory_order_relaxed) > 0)
+        {
+            called.push_back(m_functions[i]);
+        }
+    }
+    std::sort(called.begin(), called.end(), MoreExpensive());
+
+    LatencyHistogram histogram;
+    for (size_t i = 0; i < called.size(); ++i)
+    {
+        const CaplCallStats& stats = called[i]->stats;
+        histogram.Reset();
+        stats.Snapshot(histogram);
+        os << prefix << called[i]->name << ": " << histogram.Count() << " calls, "
+           << histogram.Sum() * 1e-6 << " ms";
+        if (tickNs > 0)
+        {
+            os << " (" << 100.0 * histogram.Sum() / tickNs << "% of tick time)";
+        }
+        os << ", mean " << (histogram.Count() ? histogram.Sum() / histogram.Count() : 0)
+           << " ns, p99 " << histogram.Percentile(99.0)
+           << " ns, max " << histogram.Max() << " ns";
+        uint64_t rejected = stats.rejected.load(std::memory_order_relaxed);
+        if (rejected > 0)
+        {
+            os << ", " << rejected << " refused after release";
+        }
+        os << std::endl;
+    }
+}
+
+void CaplFunctionRegistry::WriteHistograms(std::ostream& out, const std::string& linePrefix) const
+{
+    LatencyHistogram histogram;
+    for (size_t i = 0; i < m_functions.size(); ++i)
+    {
+        const CaplCallStats& stats = m_functions[i]->stats;
+        if (stats.calls.load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        histogram.Reset();
+        stats.Snapshot(histogram);
+        out << linePrefix << "\"function\":\"" << m_functions[i]->name << "\""
+            << ",\"rejected\":" << stats.rejected.load(std::memory_order_relaxed)
+            << ",\"unit\":\"ns\",\"histogram\":";
+        histogram.WriteJson(out);
+        out << "}\n";
+    }
+}
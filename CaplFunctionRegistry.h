@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CaplTypedFunction.h"
+
+// The CAPL functions a MockCapl offers to its DLL.
+//
+// Names are interned at registration: the function objects and their names
+// are placed in an arena of large blocks owned by the registry, and a
+// function is identified by its integer id from then on. Lookups by name go
+// through an open-addressing FNV-1a index, so GetCaplFunction neither
+// allocates nor builds a string.
+//
+// GetCaplFunction acquires a function and ReleaseCaplFunction releases it
+// again; a function whose acquisitions are all released refuses calls until
+// it is acquired anew. Every function counts its calls and their latency, see
+// CaplCallStats.
+class CaplFunctionRegistry
+{
+public:
+    static const int32_t NO_FUNCTION = -1;
+
+    CaplFunctionRegistry();
+    ~CaplFunctionRegistry();
+
+    // Returns the id of the new function, or NO_FUNCTION when the name is
+    // taken already.
+    template <typename Fn, Fn F>
+    int32_t Register(const char* name)
+    {
+        typedef TypedCaplFunction<Fn, F> Function;
+        static_assert(alignof(Function) <= alignof(std::max_align_t), "arena alignment");
+        if (Find(name) != NO_FUNCTION)
+        {
+            return NO_FUNCTION;
+        }
+        int32_t id = static_cast<int32_t>(m_functions.size());
+        void* memory = allocate(sizeof(Function));
+        add(new (memory) Function(intern(name), id));
+        return id;
+    }
+
+    int32_t Find(const char* name) const;
+    MockCaplFunction* Function(int32_t id) const { return m_functions[id]; }
+    size_t Count() const { return m_functions.size(); }
+
+    // Null when no function has that name.
+    MockCaplFunction* Acquire(const char* name);
+    // False for handles that are not ours or not acquired.
+    bool Release(VIACaplFunction* function);
+    // Drops every acquisition, e.g. when the library holding them is gone.
+    // The statistics are kept.
+    void ReleaseAll();
+
+    // One line per called function, the most expensive first. tickNs is the
+    // time the calls are set in relation to.
+    void PrintStatistics(std::ostream& os, const std::string& prefix, uint64_t tickNs) const;
+    // One JSON line per called function; linePrefix opens the object and
+    // may carry fields of its own.
+    void WriteHistograms(std::ostream& out, const std::string& linePrefix) const;
+
+private:
+    CaplFunctionRegistry(const CaplFunctionRegistry&);
+    CaplFunctionRegistry& operator=(const CaplFunctionRegistry&);
+
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Slot
+    {
+        uint64_t hash;
+        int32_t id;
+    };
+
+    static uint64_t hashName(const char* name);
+    void* allocate(size_t size);
+    const char* intern(const char* name);
+    void add(MockCaplFunction* function);
+    void insert(uint64_t hash, int32_t id);
+
+    std::vector<char*> m_blocks;
+    size_t m_blockUsed;                 // bytes taken in the last block
+    size_t m_blockSize;
+    std::vector<MockCaplFunction*> m_functions;     // by id
+    std::vector<Slot> m_index;
+};
@@ -0,0 +1,544 @@
+#include "CaplInstance.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "AsyncLogger.h"
+
+namespace
+{
+    thread_local CaplInstance* currentInstance = nullptr;
+
+    // Marks the instance whose DLL is called on this thread, so that the
+    // callbacks coming back through MockCapl reach the right instance.
+    class CurrentInstanceScope
+    {
+    public:
+        explicit CurrentInstanceScope(CaplInstance* instance)
+            : m_previous(currentInstance)
+        {
+            currentInstance = instance;
+        }
+        ~CurrentInstanceScope() { currentInstance = m_previous; }
+
+    private:
+        CaplInstance* m_previous;
+    };
+}
+
+FrameCapture& currentFrameCapture()
+{
+    // Callbacks outside of a DLL call are dropped by the closed capture
+    static FrameCapture unused;
+    return currentInstance != nullptr ? currentInstance->Capture() : unused;
+}
+
+void writeCanFrameCallback(CaplDword channel, CaplDword direction, CaplDword id, CaplDword type, CaplDword dlc,
+                           CaplDword rtr, CaplDword fdf, CaplDword brs, CaplDword esi, CaplDword length, CaplBytes data)
+{
+    currentFrameCapture().CaptureFrame(CAPTURE_CAN, channel, direction, id, type, dlc, rtr, fdf, brs, esi, length, data);
+    if (currentInstance == nullptr)
+    {
+        return;
+    }
+    CanFrameBuffer buffer;
+    CanFrame& frame = buffer.frame;
+    frame.timestamp_ns = 0;
+    frame.id = static_cast<uint32_t>(id);
+    frame.channel = static_cast<uint8_t>(channel);
+    frame.dlc = static_cast<uint8_t>(dlc);
+    frame.type = static_cast<uint8_t>(type);
+    frame.direction = static_cast<uint8_t>(direction);
+    frame.rtr = rtr != 0;
+    frame.fdf = fdf != 0;
+    frame.brs = brs != 0;
+    frame.esi = esi != 0;
+    frame.length = static_cast<uint8_t>(length < CAN_MAX_PAYLOAD ? length : CAN_MAX_PAYLOAD);
+    if (data != nullptr)
+    {
+        memcpy(frame.Data(), data, frame.length);
+    }
+    else
+    {
+        frame.length = 0;
+    }
+    currentInstance->TransmitCanFrame(frame);
+}
+
+CaplInstance* CaplInstance::Current()
+{
+    return currentInstance;
+}
+
+CaplInstance::CaplInstance(int index)
+    : m_index(index)
+    , m_handle(0xBEEF + index)
+    , m_port(0)
+    , m_master(1)
+    , m_tickPeriodNs(0)
+    , m_initialized(false)
+    , m_parameter(0)
+    , m_capl(0xBEEF + index)
+    , m_virtualCanBus(nullptr)
+    , m_busNode(-1)
+    , m_busFramesReceived(0)
+    , m_replayWindowEndNs(0)
+    , m_replayFinished(false)
+    , m_ethWindowEndNs(0)
+    , m_flexrayEnabled(false)
+    , m_canFramesInjected(0)
+    , m_canInjectionNs(0)
+    , m_ethFramesInjected(0)
+    , m_ethBytesInjected(0)
+    , m_ethInjectionNs(0)
+    , m_flexrayFramesInjected(0)
+    , m_flexrayInjectionNs(0)
+    , m_tickNs(0)
+{
+    m_ipAddress[0] = '\0';
+}
+
+bool CaplInstance::Open(const CaplInstanceConfig& config)
+{
+    m_port = config.basePort + m_index;
+    m_master = config.master;
+    snprintf(m_ipAddress, sizeof(m_ipAddress), "%s", config.ipAddress.c_str());
+    m_tickPeriodNs = config.tickPeriodNs;
+    m_virtualCanBus = config.virtualCanBus;
+    if (m_virtualCanBus != nullptr)
+    {
+        m_busNode = m_virtualCanBus->AddNode();
+    }
+
+    if (!m_dll.Load(config.dllPath, config.isolated))
+    {
+        m_errorDescription = m_dll.getErrorDescription();
+        return false;
+    }
+    m_service.Timers().Start(m_tickPeriodNs);
+    m_service.Node().Attach(&m_capl, "Node" + std::to_string(m_index));
+    {
+        CurrentInstanceScope scope(this);
+        setService();
+        m_dll.Functions().registerCDLL(&m_capl);
+    }
+
+    if (!openTraffic(config) || !openEthTraffic(config) || !openFlexrayTraffic(config))
+    {
+        return false;
+    }
+
+    if (!config.capturePath.empty())
+    {
+        std::string path = config.capturePath;
+        if (config.instanceCount > 1)
+        {
+            path.append(".").append(std::to_string(m_index));
+        }
+        if (!m_capture.Open(path))
+        {
+            m_errorDescription = m_capture.getErrorDescription();
+            return false;
+        }
+        LOG_INFO(LOG_CAT_CAPL, "Instance %d: capturing transmitted frames to %s", m_index, path.c_str());
+    }
+    return true;
+}
+
+bool CaplInstance::openTraffic(const CaplInstanceConfig& config)
+{
+    if (!config.replayTracePath.empty())
+    {
+        if (!m_replay.Open(config.replayTracePath))
+        {
+            m_errorDescription = m_replay.getErrorDescription();
+            return false;
+        }
+        LOG_INFO(LOG_CAT_CAPL, "Instance %d: replaying %s", m_index, config.replayTracePath.c_str());
+    }
+    else if (!config.busLoadConfigPath.empty())
+    {
+        if (!m_busLoad.Load(config.busLoadConfigPath))
+        {
+            m_errorDescription = m_busLoad.getErrorDescription();
+            return false;
+        }
+        LOG_INFO(LOG_CAT_CAPL, "Instance %d: bus load of %u periodic frames from %s",
+                 m_index, (unsigned)m_busLoad.EntryCount(), config.busLoadConfigPath.c_str());
+    }
+    else if (m_virtualCanBus == nullptr)
+    {
+        // Default traffic: one 8 byte frame 0x100 on channel 5 every tick
+        BusLoadEntry entry = {};
+        entry.id = 0x100;
+        entry.channel = 5;
+        entry.cycleNs = m_tickPeriodNs;
+        entry.length = 8;
+        for (int j = 0; j < 8; ++j)
+        {
+            entry.payload[j] = 0x10 + j;
+        }
+        m_busLoad.Add(entry);
+    }
+    m_busLoad.Start(m_tickPeriodNs);
+    return true;
+}
+
+bool CaplInstance::openEthTraffic(const CaplInstanceConfig& config)
+{
+    if (config.ethReplayPath.empty())
+    {
+        return true;
+    }
+    if (m_dll.Functions().setEthFrame == nullptr && m_dll.Functions().setEthFrames == nullptr)
+    {
+        m_errorDescription = m_dll.Path() + " exports neither setEthFrame nor setEthFrames";
+        return false;
+    }
+    if (!m_ethPool.Init())
+    {
+        m_errorDescription = m_ethPool.getErrorDescription();
+        return false;
+    }
+    m_ethTxFrames.reserve(m_ethPool.FrameCount());
+    if (!m_ethReplay.Open(config.ethReplayPath, config.ethReplayChannel))
+    {
+        m_errorDescription = m_ethReplay.getErrorDescription();
+        return false;
+    }
+    LOG_INFO(LOG_CAT_CAPL, "Instance %d: replaying Ethernet frames of %s on channel %u",
+             m_index, config.ethReplayPath.c_str(), config.ethReplayChannel);
+    return true;
+}
+
+bool CaplInstance::openFlexrayTraffic(const CaplInstanceConfig& config)
+{
+    if (config.flexraySchedulePath.empty())
+    {
+        return true;
+    }
+    if (m_dll.Functions().setFlexrayFrame == nullptr && m_dll.Functions().setFlexrayFrames == nullptr)
+    {
+        m_errorDescription = m_dll.Path() + " exports neither setFlexrayFrame nor setFlexrayFrames";
+        return false;
+    }
+    if (!m_flexray.Load(config.flexraySchedulePath))
+    {
+        m_errorDescription = m_flexray.getErrorDescription();
+        return false;
+    }
+    m_flexray.Start(m_tickPeriodNs);
+    m_flexrayTxFrames.reserve(m_flexray.MaxFramesPerTick());
+    m_flexrayEnabled = true;
+    LOG_INFO(LOG_CAT_CAPL, "Instance %d: FlexRay schedule of %u frames from %s",
+             m_index, (unsigned)m_flexray.EntryCount(), config.flexraySchedulePath.c_str());
+    return true;
+}
+
+bool CaplInstance::Reload()
+{
+    LOG_INFO(LOG_CAT_CAPL, "Instance %d: reloading %s", m_index, m_dll.Path().c_str());
+    if (!m_dll.Reload())
+    {
+        m_errorDescription = m_dll.getErrorDescription();
+        return false;
+    }
+    // The timers and sinks of the old library point into code that is gone
+    m_service.Timers().Reset();
+    m_service.SysVars().Reset();
+    m_service.CanBus().Reset();
+    m_capl.functions.ReleaseAll();
+    CurrentInstanceScope scope(this);
+    setService();
+    m_dll.Functions().registerCDLL(&m_capl);
+    m_initialized = false;
+    return true;
+}
+
+void CaplInstance::setService()
+{
+    if (m_dll.Functions().setService != nullptr)
+    {
+        m_dll.Functions().setService(&m_service);
+    }
+}
+
+void CaplInstance::SetParameter(uint32 parameter)
+{
+    m_parameter = parameter;
+    CurrentInstanceScope scope(this);
+    m_dll.Functions().setParam(m_handle, parameter);
+}
+
+void CaplInstance::Tick()
+{
+    int64_t tickStart = LatencyHistogram::Now();
+    CurrentInstanceScope scope(this);
+    if (!m_initialized)
+    {
+        m_dll.Functions().appInit(m_handle, m_ipAddress, m_port, m_master);
+        LOG_INFO(LOG_CAT_CAPL, "Instance %d: Capl DLL Initialization: Done! (port %d)", m_index, m_port);
+        m_dll.Functions().setParam(m_handle, m_parameter);
+        m_initialized = true;
+    }
+
+    // Timers first, the frames of the tick follow at the end of the window
+    m_service.Timers().RunTick();
+
+    m_canTxFrames.Reset();
+    if (m_virtualCanBus != nullptr)
+    {
+        // Sent on the virtual bus in the previous tick, ahead of this window
+        m_virtualCanBus->Collect(m_busNode, m_canTxFrames);
+        m_busFramesReceived += m_canTxFrames.Count();
+    }
+    if (m_replay.IsOpen())
+    {
+        collectReplayFrames();
+    }
+    else
+    {
+        m_busLoad.CollectTick(m_canTxFrames);
+    }
+    InjectCanFrames(m_canTxFrames.First(), m_canTxFrames.Count());
+    if (m_ethReplay.IsOpen())
+    {
+        injectEthReplay();
+    }
+    if (m_flexrayEnabled)
+    {
+        m_flexrayTxFrames.clear();
+        m_flexray.CollectTick(m_flexrayTxFrames);
+        InjectFlexrayFrames(m_flexrayTxFrames.data(), m_flexrayTxFrames.size());
+    }
+
+    m_dll.Functions().transactionofTxRxData(m_handle);
+
+    // Variables written anywhere in this tick are reported once
+    m_service.SysVars().DispatchChanges(m_service.Timers().Now());
+    m_tickNs += LatencyHistogram::Now() - tickStart;
+}
+
+// Adds the trace frames stamped inside the window of this tick.
+void CaplInstance::collectReplayFrames()
+{
+    m_replayWindowEndNs += m_tickPeriodNs;
+    m_replay.CollectUntil(m_replayWindowEndNs, m_canTxFrames);
+    if (m_replay.AtEnd() && !m_replayFinished)
+    {
+        LOG_INFO(LOG_CAT_CAPL, "Instance %d: trace replay finished after %llu frames",
+                 m_index, (unsigned long long)m_replay.FramesRead());
+        m_replayFinished = true;
+    }
+}
+
+// Injects the pcap frames of this tick window. The capture takes its own
+// reference to each frame, so the buffers return to the pool once both the
+// tick and the capture are done with them.
+void CaplInstance::injectEthReplay()
+{
+    m_ethTxFrames.clear();
+    m_ethWindowEndNs += m_tickPeriodNs;
+    m_ethReplay.CollectUntil(m_ethWindowEndNs, m_ethPool, m_ethTxFrames);
+    InjectEthFrames(m_ethTxFrames.data(), m_ethTxFrames.size());
+    for (size_t i = 0; i < m_ethTxFrames.size(); ++i)
+    {
+        m_capture.CaptureEthFrame(m_ethTxFrames[i]);
+        EthFramePool::Release(m_ethTxFrames[i]);
+    }
+}
+
+// Hands a contiguous block of frames to the DLL, through its bulk entry point
+// when it exports one and frame by frame otherwise.
+void CaplInstance::InjectCanFrames(const CanFrame* frames, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    CurrentInstanceScope scope(this);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const CaplDllFunctions& dll = m_dll.Functions();
+    if (dll.setCanFrames != nullptr)
+    {
+        dll.setCanFrames(m_handle, frames, static_cast<uint32>(count));
+    }
+    else
+    {
+        const CanFrame* msg = frames;
+        for (size_t i = 0; i < count; ++i, msg = CanFrameNext(msg))
+        {
+            dll.setCanFrame(m_handle, msg->channel, msg->direction, msg->id, msg->timestamp_ns, msg->type, msg->dlc, msg->rtr, msg->fdf, msg->brs, msg->esi,
+                            const_cast<unsigned char*>(msg->Data()));
+        }
+    }
+    m_service.CanBus().Dispatch(frames, count);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    if (m_canFramesInjected == 0)
+    {
+        m_canFirstInjection = start;
+    }
+    m_canLastInjection = end;
+    m_canFramesInjected += count;
+    m_canInjectionNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+void CaplInstance::TransmitCanFrame(const CanFrame& frame)
+{
+    if (m_virtualCanBus != nullptr)
+    {
+        m_virtualCanBus->Transmit(m_busNode, frame);
+    }
+}
+
+void CaplInstance::InjectEthFrames(const EthFrame* const* frames, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    CurrentInstanceScope scope(this);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const CaplDllFunctions& dll = m_dll.Functions();
+    size_t bytes = 0;
+    if (dll.setEthFrames != nullptr)
+    {
+        dll.setEthFrames(m_handle, frames, static_cast<uint32>(count));
+        for (size_t i = 0; i < count; ++i)
+        {
+            bytes += frames[i]->length;
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const EthFrame* frame = frames[i];
+            dll.setEthFrame(m_handle, frame->channel, frame->direction, frame->timestamp_ns, frame->length,
+                            const_cast<unsigned char*>(frame->Data()));
+            bytes += frame->length;
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    if (m_ethFramesInjected == 0)
+    {
+        m_ethFirstInjection = start;
+    }
+    m_ethLastInjection = end;
+    m_ethFramesInjected += count;
+    m_ethBytesInjected += bytes;
+    m_ethInjectionNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+void CaplInstance::InjectFlexrayFrames(const FlexrayFrame* frames, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    CurrentInstanceScope scope(this);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const CaplDllFunctions& dll = m_dll.Functions();
+    if (dll.setFlexrayFrames != nullptr)
+    {
+        dll.setFlexrayFrames(m_handle, frames, static_cast<uint32>(count));
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const FlexrayFrame& frame = frames[i];
+            dll.setFlexrayFrame(m_handle, frame.channelMask, frame.slot, frame.cycle, frame.timestamp_ns, frame.length,
+                                const_cast<unsigned char*>(frame.payload));
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    m_flexrayFramesInjected += count;
+    m_flexrayInjectionNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Flushes the remaining captured frames and closes the capture file.
+void CaplInstance::CloseCapture()
+{
+    if (m_capture.IsOpen())
+    {
+        m_capture.Close();
+        std::cout << "Instance " << m_index << " capture: " << m_capture.RecordsCaptured() << " frames, "
+                  << m_capture.RecordsDropped() << " dropped, "
+                  << m_capture.BytesWritten() << " bytes" << std::endl;
+    }
+}
+
+void CaplInstance::PrintStatistics(std::ostream& os) const
+{
+    std::ostringstream prefix;
+    prefix << "Instance " << m_index << " CAPL function ";
+    m_capl.functions.PrintStatistics(os, prefix.str(), m_tickNs);
+    if (m_service.Timers().TimersFired() > 0)
+    {
+        os << "Instance " << m_index << " timers: " << m_service.Timers().TimersFired() << " fired, "
+           << m_service.Timers().TimerCount() << " still created" << std::endl;
+    }
+    if (m_service.CanBus().Deliveries() > 0)
+    {
+        os << "Instance " << m_index << " CAN message requests: " << m_service.CanBus().RequestCount() << " active, "
+           << m_service.CanBus().Deliveries() << " deliveries" << std::endl;
+    }
+    if (m_service.SysVars().VariableCount() > 0)
+    {
+        os << "Instance " << m_index << " system variables: " << m_service.SysVars().VariableCount() << " variables, "
+           << m_service.SysVars().Writes() << " writes, "
+           << m_service.SysVars().Notifications() << " notifications" << std::endl;
+    }
+    if (m_virtualCanBus != nullptr)
+    {
+        os << "Instance " << m_index << " virtual CAN bus: " << m_virtualCanBus->FramesTransmitted(m_busNode) << " frames sent, "
+           << m_busFramesReceived << " received including the Tx echo" << std::endl;
+    }
+    if (m_replay.IsOpen())
+    {
+        os << "Instance " << m_index << " trace replay: " << m_replay.FramesRead() << " frames read, "
+           << m_replay.LinesSkipped() << " lines skipped" << std::endl;
+    }
+    if (m_canFramesInjected > 0)
+    {
+        double runSeconds = std::chrono::duration<double>(m_canLastInjection - m_canFirstInjection).count();
+        double injectSeconds = m_canInjectionNs * 1e-9;
+        os << "Instance " << m_index << " CAN injection (" << (m_dll.Functions().setCanFrames ? "bulk" : "per-frame") << "): "
+           << m_canFramesInjected << " frames, "
+           << (runSeconds > 0 ? m_canFramesInjected / runSeconds : 0.0) << " frames/s over the run, "
+           << (injectSeconds > 0 ? m_canFramesInjected / injectSeconds : 0.0) << " frames/s while injecting" << std::endl;
+    }
+    if (m_flexrayFramesInjected > 0)
+    {
+        double injectSeconds = m_flexrayInjectionNs * 1e-9;
+        os << "Instance " << m_index << " FlexRay injection (" << (m_dll.Functions().setFlexrayFrames ? "bulk" : "per-frame") << "): "
+           << m_flexrayFramesInjected << " frames, "
+           << (injectSeconds > 0 ? m_flexrayFramesInjected / injectSeconds : 0.0) << " frames/s while injecting" << std::endl;
+    }
+    if (m_ethReplay.IsOpen())
+    {
+        os << "Instance " << m_index << " Ethernet replay: " << m_ethReplay.FramesRead() << " frames read, "
+           << m_ethReplay.FramesTruncated() << " truncated, pool exhausted " << m_ethPool.Exhausted() << " times" << std::endl;
+    }
+    if (m_ethFramesInjected > 0)
+    {
+        double runSeconds = std::chrono::duration<double>(m_ethLastInjection - m_ethFirstInjection).count();
+        double injectSeconds = m_ethInjectionNs * 1e-9;
+        os << "Instance " << m_index << " Ethernet injection (" << (m_dll.Functions().setEthFrames ? "bulk" : "per-frame") << "): "
+           << m_ethFramesInjected << " frames, " << m_ethBytesInjected << " bytes, "
+           << (runSeconds > 0 ? m_ethBytesInjected / runSeconds / 1e6 : 0.0) << " MB/s over the run, "
+           << (injectSeconds > 0 ? m_ethBytesInjected / injectSeconds / 1e6 : 0.0) << " MB/s while injecting" << std::endl;
+    }
+}
+
+void CaplInstance::WriteFunctionHistograms(std::ostream& out, int tick, const char* reason) const
+{
+    std::ostringstream prefix;
+    prefix << "{\"tick\":" << tick << ",\"reason\":\"" << reason << "\",\"instance\":" << m_index << ",";
+    m_capl.functions.WriteHistograms(out, prefix.str());
+}
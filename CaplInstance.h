@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MockCaplSystem.h"
+#include "CaplDllBinding.h"
+#include "AscTraceReplay.h"
+#include "BusLoadGenerator.h"
+#include "FrameCapture.h"
+#include "MockMessages.h"
+#include "CanFrameArena.h"
+#include "EthFramePool.h"
+#include "PcapReplay.h"
+#include "FlexrayScheduler.h"
+#include "MockViaService.h"
+#include "VirtualCanBus.h"
+
+// Traffic and wiring shared by every instance of a run.
+struct CaplInstanceConfig
+{
+    std::string dllPath;
+    bool isolated;                  // load into a link-map namespace of its own
+    std::string ipAddress;
+    int basePort;                   // instance i listens on basePort + i
+    uint32 master;
+    std::string replayTracePath;
+    std::string busLoadConfigPath;
+    std::string ethReplayPath;      // pcap injected on ethReplayChannel
+    uint32_t ethReplayChannel;
+    std::string flexraySchedulePath;
+    std::string capturePath;        // suffixed with .<index> for several instances
+    int instanceCount;
+    int64_t tickPeriodNs;
+    VirtualCanBus* virtualCanBus;   // shared by all instances, may be null
+};
+
+// One CAPL DLL together with everything it needs per tick: its own handle,
+// MockCapl, port, traffic source and capture. Instances never share state,
+// so different instances may be stepped on different threads at once; one
+// instance is only ever stepped by one thread at a time.
+class CaplInstance
+{
+public:
+    explicit CaplInstance(int index);
+
+    bool Open(const CaplInstanceConfig& config);
+    // Swaps in a rebuilt DLL between two ticks, it is initialised again by
+    // the next Tick().
+    bool Reload();
+    void SetParameter(uint32 parameter);
+    // Initialises the DLL on the first call, fires the timers due in this
+    // tick, then injects the frames of this tick, lets the DLL exchange its
+    // data and reports the system variables written meanwhile.
+    void Tick();
+    // frames are count packed frames, e.g. the contents of a CanFrameArena.
+    // They also reach the CAN message requests of the DLL.
+    void InjectCanFrames(const CanFrame* frames, size_t count);
+    void InjectEthFrames(const EthFrame* const* frames, size_t count);
+    void InjectFlexrayFrames(const FlexrayFrame* frames, size_t count);
+    // Puts a frame the DLL transmits on the virtual CAN bus, if attached.
+    void TransmitCanFrame(const CanFrame& frame);
+    void CloseCapture();
+    void PrintStatistics(std::ostream& os) const;
+    // Latency histograms of the CAPL functions the DLL called, one JSON line
+    // each.
+    void WriteFunctionHistograms(std::ostream& out, int tick, const char* reason) const;
+
+    int Index() const { return m_index; }
+    uint32 Handle() const { return m_handle; }
+    FrameCapture& Capture() { return m_capture; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+    // Instance whose DLL is running on the calling thread, null outside of
+    // a DLL call.
+    static CaplInstance* Current();
+
+private:
+    CaplInstance(const CaplInstance&);
+    CaplInstance& operator=(const CaplInstance&);
+
+    void setService();
+    bool openTraffic(const CaplInstanceConfig& config);
+    bool openEthTraffic(const CaplInstanceConfig& config);
+    bool openFlexrayTraffic(const CaplInstanceConfig& config);
+    void collectReplayFrames();
+    void injectEthReplay();
+
+    int m_index;
+    uint32 m_handle;
+    int m_port;
+    uint32 m_master;
+    char m_ipAddress[16];
+    int64_t m_tickPeriodNs;
+    bool m_initialized;
+    uint32 m_parameter;
+
+    CaplDllBinding m_dll;
+    MockCapl m_capl;
+    // Handed to DLLs exporting VIASetService, owns their timers, system
+    // variables, node and CAN bus
+    MockViaService m_service;
+
+    // CAN frames handed to the DLL in the current tick, reset every tick
+    CanFrameArena m_canTxFrames;
+    VirtualCanBus* m_virtualCanBus;
+    int m_busNode;
+    uint64_t m_busFramesReceived;
+    AscTraceReplay m_replay;
+    int64_t m_replayWindowEndNs;
+    bool m_replayFinished;
+    BusLoadGenerator m_busLoad;
+
+    // Ethernet frames of the current tick, each holding a pool reference
+    // until the tick is done. The pool outlives the capture, which may still
+    // hold references.
+    EthFramePool m_ethPool;
+    PcapReplay m_ethReplay;
+    int64_t m_ethWindowEndNs;
+    std::vector<EthFrame*> m_ethTxFrames;
+
+    // FlexRay frames of the current tick, reserved for the busiest tick
+    FlexrayScheduler m_flexray;
+    bool m_flexrayEnabled;
+    std::vector<FlexrayFrame> m_flexrayTxFrames;
+
+    FrameCapture m_capture;
+
+    uint64_t m_canFramesInjected;
+    uint64_t m_canInjectionNs;
+    std::chrono::steady_clock::time_point m_canFirstInjection;
+    std::chrono::steady_clock::time_point m_canLastInjection;
+    uint64_t m_ethFramesInjected;
+    uint64_t m_ethBytesInjected;
+    uint64_t m_ethInjectionNs;
+    std::chrono::steady_clock::time_point m_ethFirstInjection;
+    std::chrono::steady_clock::time_point m_ethLastInjection;
+    uint64_t m_flexrayFramesInjected;
+    uint64_t m_flexrayInjectionNs;
+    uint64_t m_tickNs;              // spent in Tick(), the callbacks are part of it
+
+    std::string m_errorDescription;
+};
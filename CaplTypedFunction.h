@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include "VIA.h"
+#include "VIA_CDLL.h"
+#include "AsyncLogger.h"
+#include "LatencyHistogram.h"
+
+// Compile-time description of CAPL callback signatures.
+//
+// A callback is registered with its plain C++ signature. The CAPL type string
+// (see cdll.h), the parameter block size and the decoder that unpacks the
+// block into typed arguments are all generated from that signature, so a
+// call is one direct function call without runtime type checks.
+
+typedef unsigned long CaplDword;        // 'D'
+typedef long CaplLong;                  // 'L'
+typedef unsigned long long CaplQword;   // 'U'
+typedef double CaplFloat;               // 'F'
+typedef unsigned char* CaplBytes;       // 'B', byte array
+typedef char* CaplChars;                // 'C', char array
+
+template <typename T> struct CaplParam;
+template <> struct CaplParam<CaplDword> { static const char code = 'D'; };
+template <> struct CaplParam<CaplLong>  { static const char code = 'L'; };
+template <> struct CaplParam<CaplQword> { static const char code = 'U'; };
+template <> struct CaplParam<CaplFloat> { static const char code = 'F'; };
+template <> struct CaplParam<CaplBytes> { static const char code = 'B'; };
+template <> struct CaplParam<CaplChars> { static const char code = 'C'; };
+
+// The parameter block is laid out like the call stack: every parameter
+// takes at least one pointer sized slot.
+template <typename T>
+struct CaplSlot
+{
+    static const std::size_t size = sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+
+    static T Read(const unsigned char* p)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+};
+
+template <typename... Args> struct CaplSignature;
+
+template <>
+struct CaplSignature<>
+{
+    static const std::size_t size = 0;
+};
+
+template <typename First, typename... Rest>
+struct CaplSignature<First, Rest...>
+{
+    static const std::size_t size = CaplSlot<First>::size + CaplSignature<Rest...>::size;
+};
+
+// Byte offset of parameter I in the block.
+template <std::size_t I, typename... Args> struct CaplOffset;
+
+template <typename First, typename... Rest>
+struct CaplOffset<0, First, Rest...>
+{
+    static const std::size_t value = 0;
+};
+
+template <std::size_t I, typename First, typename... Rest>
+struct CaplOffset<I, First, Rest...>
+{
+    static const std::size_t value = CaplSlot<First>::size + CaplOffset<I - 1, Rest...>::value;
+};
+
+template <typename... Args>
+struct CaplTypes
+{
+    static constexpr char value[] = { CaplParam<Args>::code..., '\0' };
+};
+
+template <typename... Args>
+constexpr char CaplTypes<Args...>::value[];
+
+template <typename Fn> struct CaplFunctionTraits;
+
+template <typename R, typename... Args>
+struct CaplFunctionTraits<R (*)(Args...)>
+{
+    typedef CaplTypes<Args...> Types;
+};
+
+constexpr bool caplTypesEqual(const char* a, const char* b)
+{
+    return *a == *b && (*a == '\0' || caplTypesEqual(a + 1, b + 1));
+}
+
+template <std::size_t... I> struct CaplIndexSequence {};
+template <std::size_t N, std::size_t... I>
+struct CaplMakeIndexSequence : CaplMakeIndexSequence<N - 1, N - 1, I...> {};
+template <std::size_t... I>
+struct CaplMakeIndexSequence<0, I...> { typedef CaplIndexSequence<I...> type; };
+
+// Return value handling, CAPL results travel as uint32.
+template <typename R>
+struct CaplResult
+{
+    static const char code = CaplParam<R>::code;
+
+    template <typename Fn, typename... Args>
+    static uint32 Invoke(Fn fn, Args... args) { return static_cast<uint32>(fn(args...)); }
+};
+
+template <>
+struct CaplResult<void>
+{
+    static const char code = 'V';
+
+    template <typename Fn, typename... Args>
+    static uint32 Invoke(Fn fn, Args... args) { fn(args...); return 0; }
+};
+
+// Calls of one CAPL function. The counters are relaxed atomics, so the
+// instances stepped on worker threads never wait for each other, and the
+// statistics can be read while they run.
+struct CaplCallStats
+{
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> rejected;     // made through a released handle
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> minNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> buckets[LatencyHistogram::BUCKET_COUNT];
+
+    CaplCallStats()
+        : calls(0), rejected(0), totalNs(0), minNs(UINT64_MAX), maxNs(0)
+    {
+        for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Record(int64_t valueNs)
+    {
+        uint64_t value = valueNs > 0 ? static_cast<uint64_t>(valueNs) : 0;
+        buckets[LatencyHistogram::BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        calls.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = minNs.load(std::memory_order_relaxed);
+        while (value < seen && !minNs.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+        {
+        }
+        seen = maxNs.load(std::memory_order_relaxed);
+        while (value > seen && !maxNs.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Adds the calls counted so far to histogram.
+    void Snapshot(LatencyHistogram& histogram) const
+    {
+        uint64_t counts[LatencyHistogram::BUCKET_COUNT];
+        for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        histogram.Add(counts, totalNs.load(std::memory_order_relaxed),
+                      minNs.load(std::memory_order_relaxed), maxNs.load(std::memory_order_relaxed));
+    }
+};
+
+// --- Mock VIACaplFunction Implementation ---
+// Created and owned by CaplFunctionRegistry, which interns the name and
+// hands out the function by its id.
+class MockCaplFunction : public VIACaplFunction {
+public:
+    const char* name;
+    int32 id;
+    const char* paramTypes;
+    char returnType;
+    int32 paramSize;
+    std::atomic<int32> acquired;        // GetCaplFunction() not yet released
+    CaplCallStats stats;
+
+    MockCaplFunction(const char* n, int32 i, const char* ptypes, char rtype, int32 psize)
+        : name(n), id(i), paramTypes(ptypes), returnType(rtype), paramSize(psize), acquired(0) {}
+
+    virtual ~MockCaplFunction() {}
+
+    VIASTDDECL ParamSize(int32* size) override {
+        if (!size) return kVIA_DBParameterInvalid;
+        *size = paramSize;
+        return kVIA_OK;
+    }
+
+    VIASTDDECL ParamCount(int32* size) override {
+        if (!size) return kVIA_DBParameterInvalid;
+        *size = static_cast<int32>(std::strlen(paramTypes));
+        return kVIA_OK;
+    }
+
+    VIASTDDECL ParamType(char* type, int32 nth) override {
+        if (!type || nth < 0 || nth >= static_cast<int32>(std::strlen(paramTypes)))
+        return kVIA_DBParameterInvalid;
+        *type = paramTypes[nth];
+        return kVIA_OK;
+    }
+
+    VIASTDDECL ResultType(char* type) override {
+        if (!type) return kVIA_DBParameterInvalid;
+        *type = returnType;
+        return kVIA_OK;
+    }
+
+    VIASTDDECL CallReturnsDouble(double* result, void* params) override {
+        uint32 value = 0;
+        VIAResult rc = Call(&value, params);
+        *result = value;
+        return rc;
+    }
+};
+
+// MockCaplFunction calling F with the arguments decoded from the block.
+template <typename Fn, Fn F> class TypedCaplFunction;
+
+template <typename R, typename... Args, R (*F)(Args...)>
+class TypedCaplFunction<R (*)(Args...), F> : public MockCaplFunction
+{
+public:
+    TypedCaplFunction(const char* n, int32 i)
+        : MockCaplFunction(n, i, CaplTypes<Args...>::value, CaplResult<R>::code,
+                           static_cast<int32>(CaplSignature<Args...>::size)) {}
+
+    VIASTDDECL Call(uint32* result, void* params) override {
+        LOG_TRACE(LOG_CAT_CAPL, "Mock: Calling CAPL function %s", this->name);
+        if (!result || (sizeof...(Args) > 0 && !params)) return kVIA_DBParameterInvalid;
+        if (this->acquired.load(std::memory_order_relaxed) <= 0) {
+            this->stats.rejected.fetch_add(1, std::memory_order_relaxed);
+            return kVIA_ObjectInvalid;
+        }
+        int64_t start = LatencyHistogram::Now();
+        *result = invoke(static_cast<const unsigned char*>(params),
+                         typename CaplMakeIndexSequence<sizeof...(Args)>::type());
+        this->stats.Record(LatencyHistogram::Now() - start);
+        return kVIA_OK;
+    }
+
+private:
+    template <std::size_t... I>
+    static uint32 invoke(const unsigned char* params, CaplIndexSequence<I...>) {
+        (void)params;
+        return CaplResult<R>::Invoke(F, CaplSlot<Args>::Read(params + CaplOffset<I, Args...>::value)...);
+    }
+};
@@ -0,0 +1,82 @@
+#include "CaplWorkerPool.h"
+#include "CaplInstance.h"
+
+CaplWorkerPool::CaplWorkerPool()
+    : m_workerCount(0)
+    , m_generation(0)
+    , m_pending(0)
+    , m_stopping(false)
+{
+}
+
+CaplWorkerPool::~CaplWorkerPool()
+{
+    Stop();
+}
+
+void CaplWorkerPool::Start(const std::vector<CaplInstance*>& instances, int workerCount)
+{
+    Stop();
+    m_instances = instances;
+    if (workerCount > static_cast<int>(instances.size()))
+    {
+        workerCount = static_cast<int>(instances.size());
+    }
+    m_workerCount = workerCount;
+    m_stopping = false;
+    for (int w = 0; w < workerCount; ++w)
+    {
+        m_workers.push_back(std::thread(&CaplWorkerPool::run, this, w, m_generation));
+    }
+}
+
+void CaplWorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_startCondition.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+    m_workerCount = 0;
+}
+
+void CaplWorkerPool::Tick()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending = m_workerCount;
+    ++m_generation;
+    m_startCondition.notify_all();
+    m_doneCondition.wait(lock, [this] { return m_pending == 0; });
+}
+
+void CaplWorkerPool::run(int worker, unsigned long seen)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCondition.wait(lock, [this, seen] { return m_stopping || m_generation != seen; });
+            if (m_stopping)
+            {
+                return;
+            }
+            seen = m_generation;
+        }
+
+        for (size_t i = worker; i < m_instances.size(); i += m_workerCount)
+        {
+            m_instances[i]->Tick();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0)
+        {
+            m_doneCondition.notify_one();
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CaplInstance;
+
+// Steps a set of CAPL instances in lockstep. Tick() releases every worker for
+// one generation and returns once all of them are done, so no instance ever
+// runs ahead of the tick master. Worker w owns the instances w, w + W, ...
+// for the whole run, which keeps each DLL on one thread.
+class CaplWorkerPool
+{
+public:
+    CaplWorkerPool();
+    ~CaplWorkerPool();
+
+    void Start(const std::vector<CaplInstance*>& instances, int workerCount);
+    void Stop();
+    void Tick();
+
+    int WorkerCount() const { return m_workerCount; }
+
+private:
+    CaplWorkerPool(const CaplWorkerPool&);
+    CaplWorkerPool& operator=(const CaplWorkerPool&);
+
+    void run(int worker, unsigned long seen);
+
+    std::vector<CaplInstance*> m_instances;
+    std::vector<std::thread> m_workers;
+    int m_workerCount;
+    std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_doneCondition;
+    unsigned long m_generation;
+    int m_pending;
+    bool m_stopping;
+};
@@ -0,0 +1,84 @@
+#include "EthFramePool.h"
+#include <new>
+
+EthFramePool::EthFramePool()
+    : m_blocks(nullptr)
+    , m_frameCount(0)
+    , m_freeTop(NO_BLOCK)
+    , m_exhausted(0)
+{
+}
+
+EthFramePool::~EthFramePool()
+{
+    delete[] m_blocks;
+}
+
+bool EthFramePool::Init(size_t frameCount)
+{
+    delete[] m_blocks;
+    m_blocks = new (std::nothrow) Block[frameCount];
+    if (m_blocks == nullptr)
+    {
+        m_frameCount = 0;
+        m_errorDescription = "Cannot allocate " + std::to_string(frameCount) + " Ethernet frame buffers";
+        return false;
+    }
+    m_frameCount = frameCount;
+    m_exhausted = 0;
+    m_freeTop = NO_BLOCK;
+    for (size_t i = frameCount; i-- > 0;)
+    {
+        m_blocks[i].pool = this;
+        m_blocks[i].refs = 0;
+        push(&m_blocks[i]);
+    }
+    return true;
+}
+
+EthFramePool::Block* EthFramePool::blockOf(const EthFrame* frame)
+{
+    return reinterpret_cast<Block*>(const_cast<char*>(reinterpret_cast<const char*>(frame) - offsetof(Block, frame)));
+}
+
+void EthFramePool::push(Block* block)
+{
+    uint32_t index = static_cast<uint32_t>(block - m_blocks);
+    uint32_t top = m_freeTop.load(std::memory_order_relaxed);
+    do
+    {
+        block->next = top;
+    } while (!m_freeTop.compare_exchange_weak(top, index, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// Only one thread pops, so a block cannot be popped and pushed back between
+// the load and the exchange (no ABA).
+EthFrame* EthFramePool::Acquire()
+{
+    uint32_t top = m_freeTop.load(std::memory_order_acquire);
+    while (top != NO_BLOCK)
+    {
+        if (m_freeTop.compare_exchange_weak(top, m_blocks[top].next, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            Block& block = m_blocks[top];
+            block.refs.store(1, std::memory_order_relaxed);
+            return &block.frame;
+        }
+    }
+    m_exhausted++;
+    return nullptr;
+}
+
+void EthFramePool::AddRef(const EthFrame* frame)
+{
+    blockOf(frame)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EthFramePool::Release(const EthFrame* frame)
+{
+    Block* block = blockOf(frame);
+    if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        block->pool->push(block);
+    }
+}
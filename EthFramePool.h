@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include "MockMessages.h"
+
+// Fixed set of jumbo-capable Ethernet frame buffers, allocated once by
+// Init(). A frame is reference counted: the replay acquires it, the capture
+// adds a reference while the frame waits in its ring, and the buffer goes
+// back to the pool when the last holder releases it. That way one buffer is
+// handed to the DLL and written to the capture without copying the payload.
+//
+// Acquire() must only be called from one thread; Release() may be called
+// from any thread, the free list is a lock-free stack.
+class EthFramePool
+{
+public:
+    static const size_t DEFAULT_FRAME_COUNT = 1024;
+
+    EthFramePool();
+    ~EthFramePool();
+
+    bool Init(size_t frameCount = DEFAULT_FRAME_COUNT);
+
+    // Returns a frame with one reference, or null when every buffer is taken.
+    EthFrame* Acquire();
+    static void AddRef(const EthFrame* frame);
+    static void Release(const EthFrame* frame);
+
+    size_t FrameCount() const { return m_frameCount; }
+    uint64_t Exhausted() const { return m_exhausted; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    EthFramePool(const EthFramePool&);
+    EthFramePool& operator=(const EthFramePool&);
+
+    static const uint32_t NO_BLOCK = 0xFFFFFFFFu;
+
+    struct Block
+    {
+        EthFramePool* pool;
+        std::atomic<uint32_t> refs;
+        uint32_t next;              // free list link
+        EthFrame frame;
+        unsigned char payload[ETH_MAX_PAYLOAD];
+    };
+
+    static Block* blockOf(const EthFrame* frame);
+    void push(Block* block);
+
+    Block* m_blocks;
+    size_t m_frameCount;
+    std::atomic<uint32_t> m_freeTop;
+    uint64_t m_exhausted;
+    std::string m_errorDescription;
+};
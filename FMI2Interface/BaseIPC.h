@@ -37,7 +37,8 @@ typedef enum {
 	IPC_RETURN_SUCCESS,
 	IPC_RETURN_ERROR,
 	IPC_RETURN_WARNING,
-	IPC_RETURN_RESET
+	IPC_RETURN_RESET,
+	IPC_RETURN_TIMEOUT
 } IPC_RETURN_TYPE;
 
 typedef enum {
@@ -46,6 +47,42 @@ typedef enum {
 	IPC_ACK_RESET
 } IPC_ACK_TYPE;
 
+// Answer to IPC_ACK_RESET asking the controller to keep the connection open
+// and to send PACKET_SERVER_READY on it once the restart is complete.
+const static uint64_t IPC_RESET_KEEP_CONNECTION = 0x5045454B; // "KEEP"
+
+// Command word of the sequenced step frame. The legacy lock-step protocol sends a
+// bare uint64_t step size and receives a 4 byte IPC_ACK_TYPE instead.
+const static uint32_t IPC_CMD_STEP = 0x50455453; // "STEP"
+// Command word of a frame advancing stepCount steps with one aggregated ack.
+const static uint32_t IPC_CMD_STEP_BATCH = 0x48435442; // "BTCH"
+
+// Upper bound for the number of step frames that may be in flight at once.
+const static int IPC_MAX_STEP_WINDOW = 64;
+
+#pragma pack(push, 1)
+// Step request of the windowed tick protocol.
+struct IPCStepFrame {
+	uint32_t command;     // IPC_CMD_STEP or IPC_CMD_STEP_BATCH
+	uint32_t sequence;    // incremented per frame, echoed in the ack
+	uint64_t stepSize;    // communication step size in microseconds
+	uint32_t stepCount;   // steps to advance, 1 for IPC_CMD_STEP
+};
+
+// Acknowledge of one IPCStepFrame, acks arrive in sequence order.
+struct IPCStepAck {
+	int32_t  status;      // IPC_ACK_TYPE, first non-OK status of a batch
+	uint32_t sequence;    // sequence of the acknowledged step frame
+	uint32_t stepIndex;   // step the status refers to, stepCount when all passed
+};
+#pragma pack(pop)
+
+// One element of a scatter-gather transfer.
+struct IPCBuffer {
+	void* pData;
+	int   iDataSize;
+};
+
 class IBaseIPC
 {
 public:
@@ -58,5 +95,40 @@ public:
 	virtual std::string getErrorDescription() = 0;
 	virtual ~IBaseIPC() {}
 	virtual void CloseCommunication() = 0;
+	// Deadline in milliseconds applied to every blocking call, -1 waits forever.
+	virtual void SetTimeout(int iTimeoutMs) {}
+
+	// Sends the buffers back to back as one message. Transports that support
+	// gathering writes override this, the fallback issues one WriteData each.
+	virtual IPC_RETURN_TYPE WriteDataV(const IPCBuffer* pBuffers, int iBufferCount)
+	{
+		for (int i = 0; i < iBufferCount; ++i)
+		{
+			IPC_RETURN_TYPE ret = WriteData(pBuffers[i].pData, pBuffers[i].iDataSize);
+			if (ret != IPC_RETURN_SUCCESS)
+			{
+				return ret;
+			}
+		}
+		return IPC_RETURN_SUCCESS;
+	}
+
+	// Fills the buffers in order from the incoming data, readDataSize is the
+	// total number of bytes received.
+	virtual IPC_RETURN_TYPE ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize)
+	{
+		*readDataSize = 0;
+		for (int i = 0; i < iBufferCount; ++i)
+		{
+			int received = 0;
+			IPC_RETURN_TYPE ret = ReadData(pBuffers[i].pData, pBuffers[i].iDataSize, &received);
+			if (ret != IPC_RETURN_SUCCESS)
+			{
+				return ret;
+			}
+			*readDataSize += received;
+		}
+		return IPC_RETURN_SUCCESS;
+	}
 };
 
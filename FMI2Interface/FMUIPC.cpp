@@ -7,33 +7,93 @@
 
 
 #include "FMUIPC.h"
+#include "AsyncLogger.h"
 #include <string.h>
 #include <iostream>
 #include <vector>
 #include <algorithm>
 
 #ifdef __linux__
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
+#define SOCKET_TIMEOUT -2
 #endif
 
+namespace
+{
+	// Longest pause between two connection attempts while the server is not up.
+	const int TCP_MAX_RETRY_DELAY_US = 100 * 1000;
+
+#ifdef __linux__
+	// iovec entries handed to one sendmsg/recvmsg, larger lists go in rounds.
+	const int IPC_MAX_IOV = 64;
+
+	// Maps the not yet transferred part of pBuffers, starting offset bytes
+	// into the first buffer, onto iov and returns the number of entries used.
+	int buildIoVec(iovec* iov, const IPCBuffer* pBuffers, int iBufferCount, size_t offset)
+	{
+		int count = 0;
+		for (int i = 0; i < iBufferCount && count < IPC_MAX_IOV; ++i)
+		{
+			iov[count].iov_base = (char*)pBuffers[i].pData + offset;
+			iov[count].iov_len = pBuffers[i].iDataSize - offset;
+			offset = 0;
+			++count;
+		}
+		return count;
+	}
+
+	// Moves (next, offset) forward by the number of bytes transferred and
+	// skips empty buffers.
+	void advanceIoVec(const IPCBuffer* pBuffers, int iBufferCount, int& next, size_t& offset, size_t bytes)
+	{
+		while (next < iBufferCount)
+		{
+			size_t left = pBuffers[next].iDataSize - offset;
+			if (bytes < left)
+			{
+				offset += bytes;
+				return;
+			}
+			bytes -= left;
+			offset = 0;
+			++next;
+		}
+	}
+#endif
+}
+
 // #define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
 #ifndef __linux__ 
 #pragma warning(disable:4996)
 #endif
 
 FMUTCP::FMUTCP()
-    :m_sockfd(0)
+    :m_sockfd(INVALID_SOCKET)
+	, m_epollfd(INVALID_SOCKET)
+	, m_epollEvents(0)
+	, m_timeoutMs(-1)
 	, m_portNum(VINC_SENDER_PORT)
     , m_IP_Address(LOCAL_IP_ADDRESS)
     , m_canSend(vINC_SUCCESS)	
 {    
-
+#ifdef __linux__
+	m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+#endif
 }
 
 FMUTCP::~FMUTCP()
 {
 	CloseCommunication();
+#ifdef __linux__
+	if (m_epollfd != INVALID_SOCKET)
+	{
+		close(m_epollfd);
+	}
+#endif
 }
 
 FMUUDP::FMUUDP()
@@ -76,13 +136,9 @@ int  FMUTCP::resolveAddress(std::string& errorMsg)
 	// Resolve the server address and port
 	int iResult = getaddrinfo(m_IP_Address.c_str(), m_portNum.c_str(), &hints, &result);
 	if (iResult != 0) {
-		//printf("getaddrinfo failed with error: %d\n", iResult);
-		//errorMsg = "getaddrinfo failed with error.";
 		GetErrorMsgDescription(errorMsg);
 #ifdef  _WIN32
 		WSACleanup();
-#elif __linux__
-  close(m_sockfd);
 #endif
 		return 1;
 	}
@@ -90,32 +146,57 @@ int  FMUTCP::resolveAddress(std::string& errorMsg)
 	// Attempt to connect to an address until one succeeds
 	for (ptr = result; ptr != NULL;ptr = ptr->ai_next) {
 
-		// Create a SOCKET for connecting to server
+		// Create a non-blocking SOCKET for connecting to server
+#ifdef __linux__
+		m_sockfd = socket(ptr->ai_family, ptr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			ptr->ai_protocol);
+#else
 		m_sockfd = socket(ptr->ai_family, ptr->ai_socktype,
 			ptr->ai_protocol);
+#endif
 		if (m_sockfd == INVALID_SOCKET) {
-			//printf("socket failed with error: %ld\n", WSAGetLastError());
-			//errorMsg = "socket failed with error.";
 			GetErrorMsgDescription(errorMsg);
 			freeaddrinfo(result);
 #ifdef  _WIN32
 			WSACleanup();
-#elif __linux__
-            close(m_sockfd);
 #endif
 			return 1;
 		}
         
         iResult = connect(m_sockfd, ptr->ai_addr, (int)ptr->ai_addrlen);
+#ifdef __linux__
+        if (iResult == -1 && errno == EINPROGRESS) {
+            // Connection is pending, wait for the socket to become writable
+            int soError = 0;
+            socklen_t soErrorLen = sizeof(soError);
+            if (watchSocket() && waitForSocket(EPOLLOUT, makeDeadline()) > 0 &&
+                getsockopt(m_sockfd, SOL_SOCKET, SO_ERROR, &soError, &soErrorLen) == 0 && soError == 0) {
+                iResult = 0;
+            }
+        }
+        // A pending connect left the socket registered for EPOLLOUT, switch
+        // it back to EPOLLIN or the ack waits would spin on a writable socket
+        if (iResult == 0 && !watchSocket()) {
+            GetErrorMsgDescription(errorMsg);
+            iResult = -1;
+        }
+#endif
         if ( iResult == -1 ) {
 #ifdef  _WIN32
             closesocket( m_sockfd );
 #else
+            // Closing the descriptor also drops it from the epoll set
             close( m_sockfd );
+            m_epollEvents = 0;
 #endif
             m_sockfd = -1;
             continue;
         }
+#ifdef __linux__
+        // Step frames are tiny, do not let Nagle hold them back
+        int noDelay = 1;
+        setsockopt(m_sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+#endif
         bRet = 0;
         break;
 	}	
@@ -140,7 +221,7 @@ int  FMUUDP::resolveAddress(std::string& errorMsg)
 	// Resolve the server address and port
 	int iResult = getaddrinfo(m_IP_Address.c_str(), m_portNum.c_str(), &hints, &result);
 	if (iResult != 0) {
-		printf("getaddrinfo failed with error: %d\n", iResult);
+		LOG_ERROR(LOG_CAT_IPC, "getaddrinfo failed with error: %d", iResult);
 		//errorMsg = "getaddrinfo failed with error.";
 		GetErrorMsgDescription(errorMsg);
 #ifdef  _WIN32
@@ -159,7 +240,7 @@ int  FMUUDP::resolveAddress(std::string& errorMsg)
 		m_sockfd = socket(ptr->ai_family, ptr->ai_socktype,
 			ptr->ai_protocol);
 		if (m_sockfd == INVALID_SOCKET) {
-			printf("socket failed with error: %d\n", IPC_ERROR);
+			LOG_ERROR(LOG_CAT_IPC, "socket failed with error: %d", IPC_ERROR);
 			//errorMsg = "socket failed with error.";
 			GetErrorMsgDescription(errorMsg);
 			freeaddrinfo(result);
@@ -188,7 +269,7 @@ int  FMUUDP::resolveAddress(std::string& errorMsg)
 		do
 		{
 			bindResult = connect(m_sockfd, ptr->ai_addr, (int)ptr->ai_addrlen);
-			printf("socket connect result : %d\n", bindResult);
+			LOG_DEBUG(LOG_CAT_IPC, "socket connect result : %d", bindResult);
 #ifdef  _WIN32
 			Sleep(1000);
 #elif __linux__
@@ -239,23 +320,27 @@ IPC_RETURN_TYPE FMUTCP::OpenCommunication()
 		return IPC_RETURN_ERROR;
 	}
 #endif
-	#ifdef __linux__
-	  sleep(1);
-	#endif
-    
+	// Retry until the server accepts, backing off from 100 us up to TCP_MAX_RETRY_DELAY_US
+	// instead of sleeping a full second per attempt.
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	int retryDelayUs = 100;
+	m_errorDescription.clear();
 	while (1 == resolveAddress(m_errorDescription))
 	{
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			m_errorDescription = "Socket Error: timed out connecting to " + m_IP_Address + ":" + m_portNum;
+			return IPC_RETURN_TIMEOUT;
+		}
+		m_errorDescription.clear();
 #ifdef __linux__
-        sleep(1);
+		usleep(retryDelayUs);
 #endif
+		retryDelayUs = std::min(retryDelayUs * 2, TCP_MAX_RETRY_DELAY_US);
 	}
 	if (m_sockfd == INVALID_SOCKET) {
-		//printf("Unable to connect to server!\n");
-		//errorMsg = "WSAStartup failed with error.";
 #ifdef  _WIN32
 		WSACleanup();
-#elif __linux__
-  close(m_sockfd);
 #endif
 		return IPC_RETURN_ERROR;
 	}
@@ -302,20 +387,41 @@ IPC_RETURN_TYPE FMUTCP::waitForServerToClose()
 {
     char buffer[1024];
 
-    std::cout << "[fmu wait] Waiting for server to close connection...\n";
+    if (m_sockfd == INVALID_SOCKET) {
+        // Our side is already closed, there is nothing left to drain.
+        return IPC_RETURN_SUCCESS;
+    }
+
+    LOG_INFO(LOG_CAT_IPC, "[fmu wait] Waiting for server to close connection...");
     
+    std::chrono::steady_clock::time_point deadline = makeDeadline();
     while (true)
     {
         int rc = recv(m_sockfd, buffer, sizeof(buffer), 0);
 
         if (rc == 0) {
-            std::cout << "[fmu wait] Server closed the connection (recv = 0).\n";
+            LOG_INFO(LOG_CAT_IPC, "[fmu wait] Server closed the connection (recv = 0).");
             return IPC_RETURN_SUCCESS;
         } else if (rc < 0) {
-            std::cerr << "[fmu wait] recv() failed: " << strerror(errno) << "\n";
+#ifdef __linux__
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                int ready = waitForSocket(EPOLLIN, deadline);
+                if (ready == 0) {
+                    m_errorDescription = "Socket Error: timed out waiting for server to close";
+                    return IPC_RETURN_TIMEOUT;
+                }
+                if (ready > 0) {
+                    continue;
+                }
+            }
+#endif
+            LOG_ERROR(LOG_CAT_IPC, "[fmu wait] recv() failed: %s", strerror(errno));
             return IPC_RETURN_ERROR;
         } else {
-            std::cout << "[fmu wait] Discarding " << rc << " bytes of residual data from server...\n";
+            LOG_DEBUG(LOG_CAT_IPC, "[fmu wait] Discarding %d bytes of residual data from server...", rc);
             // Keep draining until server closes
         }
     }
@@ -323,7 +429,12 @@ IPC_RETURN_TYPE FMUTCP::waitForServerToClose()
 
 IPC_RETURN_TYPE FMUTCP::WriteData(void* pMemData, int iDataSize)
 {
-	if (SOCKET_ERROR == WriteToSocket(pMemData, iDataSize, m_errorDescription))
+	int iResult = WriteToSocket(pMemData, iDataSize, m_errorDescription);
+	if (SOCKET_TIMEOUT == iResult)
+	{
+		return IPC_RETURN_TIMEOUT;
+	}
+	if (SOCKET_ERROR == iResult)
 	{
 		return IPC_RETURN_ERROR;
 	}
@@ -340,34 +451,178 @@ IPC_RETURN_TYPE FMUUDP::WriteData(void* pMemData, int iDataSize)
 	return IPC_RETURN_SUCCESS;
 }
 
-IPC_RETURN_TYPE FMUTCP::ReadStatus( int* recv_value )
+IPC_RETURN_TYPE FMUTCP::WriteDataV(const IPCBuffer* pBuffers, int iBufferCount)
 {
-    IPC_RETURN_TYPE retValue = IPC_RETURN_ERROR;
-    if ( m_sockfd == INVALID_SOCKET ) {
-        printf( "FMU socket invalid\n" );
-        return retValue;
-    }
+#ifdef __linux__
+	if (m_canSend || m_sockfd == INVALID_SOCKET)
+		return IPC_RETURN_ERROR;
 
-    int buffer;
-    int bytecount = 0;
+	// Header, label arrays and payload leave in one sendmsg without being
+	// copied into a staging buffer first.
+	iovec iov[IPC_MAX_IOV];
+	int next = 0;
+	size_t offset = 0;
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	advanceIoVec(pBuffers, iBufferCount, next, offset, 0);
+	while (next < iBufferCount)
+	{
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = buildIoVec(iov, pBuffers + next, iBufferCount - next, offset);
 
-    // Peek into the socket and get the packet size
-    if ( ( bytecount = recv( m_sockfd, (char*)&buffer, 4, 0 ) ) == -1 )
-    {
-        fprintf( stderr, "Error: Receiving data %d\n", errno );
-        return retValue;
-    }
-    else if ( bytecount == 0 )
-        printf( "Connection closed\n" );
-	*recv_value = buffer;
-    return IPC_RETURN_SUCCESS;
+		ssize_t sent = sendmsg(m_sockfd, &msg, MSG_NOSIGNAL);
+		if (sent >= 0)
+		{
+			advanceIoVec(pBuffers, iBufferCount, next, offset, static_cast<size_t>(sent));
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			int ready = waitForSocket(EPOLLOUT, deadline);
+			if (ready == 0)
+			{
+				m_errorDescription = "Socket Error: send timed out";
+				return IPC_RETURN_TIMEOUT;
+			}
+			if (ready > 0)
+				continue;
+		}
+		GetErrorMsgDescription(m_errorDescription);
+		CloseCommunication();
+		return IPC_RETURN_ERROR;
+	}
+	return IPC_RETURN_SUCCESS;
+#else
+	return IBaseIPC::WriteDataV(pBuffers, iBufferCount);
+#endif
+}
+
+IPC_RETURN_TYPE FMUTCP::ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize)
+{
+#ifdef __linux__
+	m_errorDescription.clear();
+	*readDataSize = 0;
+	if (m_sockfd == INVALID_SOCKET)
+		return IPC_RETURN_ERROR;
+
+	iovec iov[IPC_MAX_IOV];
+	int next = 0;
+	size_t offset = 0;
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	advanceIoVec(pBuffers, iBufferCount, next, offset, 0);
+	while (next < iBufferCount)
+	{
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = buildIoVec(iov, pBuffers + next, iBufferCount - next, offset);
+
+		ssize_t received = recvmsg(m_sockfd, &msg, 0);
+		if (received > 0)
+		{
+			*readDataSize += static_cast<int>(received);
+			advanceIoVec(pBuffers, iBufferCount, next, offset, static_cast<size_t>(received));
+			continue;
+		}
+		if (received == 0)
+		{
+			m_errorDescription = "Socket Error: connection closed";
+			return IPC_RETURN_ERROR;
+		}
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			int ready = waitForSocket(EPOLLIN, deadline);
+			if (ready == 0)
+			{
+				m_errorDescription = "Socket Error: receive timed out";
+				return IPC_RETURN_TIMEOUT;
+			}
+			if (ready > 0)
+				continue;
+		}
+		GetErrorMsgDescription(m_errorDescription);
+		return IPC_RETURN_ERROR;
+	}
+	return IPC_RETURN_SUCCESS;
+#else
+	return IBaseIPC::ReadDataV(pBuffers, iBufferCount, readDataSize);
+#endif
+}
+
+IPC_RETURN_TYPE FMUUDP::WriteDataV(const IPCBuffer* pBuffers, int iBufferCount)
+{
+#ifdef __linux__
+	if (m_canSend || iBufferCount > IPC_MAX_IOV)
+		return IPC_RETURN_ERROR;
+
+	// A datagram has to go out in a single call
+	iovec iov[IPC_MAX_IOV];
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = m_socketAddr;
+	msg.msg_namelen = sizeof(sockaddr_in);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = buildIoVec(iov, pBuffers, iBufferCount, 0);
+
+	if (sendmsg(m_sockfd, &msg, 0) == SOCKET_ERROR)
+	{
+		GetErrorMsgDescription(m_errorDescription);
+		LOG_ERROR(LOG_CAT_IPC, "send failed with error: %s", m_errorDescription.c_str());
+		return IPC_RETURN_ERROR;
+	}
+	return IPC_RETURN_SUCCESS;
+#else
+	return IBaseIPC::WriteDataV(pBuffers, iBufferCount);
+#endif
+}
+
+IPC_RETURN_TYPE FMUUDP::ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize)
+{
+#ifdef __linux__
+	*readDataSize = 0;
+	if (m_sockfd == INVALID_SOCKET || iBufferCount > IPC_MAX_IOV)
+		return IPC_RETURN_ERROR;
+
+	// One datagram is scattered over the buffers
+	iovec iov[IPC_MAX_IOV];
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = m_socketAddr;
+	msg.msg_namelen = sizeof(sockaddr_in);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = buildIoVec(iov, pBuffers, iBufferCount, 0);
+
+	ssize_t received = recvmsg(m_sockfd, &msg, 0);
+	if (received < 0)
+	{
+		GetErrorMsgDescription(m_errorDescription);
+		LOG_ERROR(LOG_CAT_IPC, "Error: Receiving data %d", errno);
+		return IPC_RETURN_ERROR;
+	}
+	*readDataSize = static_cast<int>(received);
+	return IPC_RETURN_SUCCESS;
+#else
+	return IBaseIPC::ReadDataV(pBuffers, iBufferCount, readDataSize);
+#endif
+}
+
+IPC_RETURN_TYPE FMUTCP::ReadStatus( int* recv_value )
+{
+    int readDataSize = 0;
+    // Framed read: a status is only returned once all 4 bytes arrived
+    return ReadData( recv_value, sizeof( int ), &readDataSize );
 }
 
 IPC_RETURN_TYPE FMUUDP::ReadStatus(int* recv_value)
 {
 	IPC_RETURN_TYPE retValue = IPC_RETURN_ERROR;
 	if (m_sockfd == INVALID_SOCKET) {
-		printf("FMU socket invalid\n");
+		LOG_ERROR(LOG_CAT_IPC, "FMU socket invalid");
 		return retValue;
 	}
 
@@ -378,41 +633,44 @@ IPC_RETURN_TYPE FMUUDP::ReadStatus(int* recv_value)
 	// Peek into the socket and get the packet size
 	if ((bytecount = recvfrom(m_sockfd, (char*)&buffer, 4, 0, (struct sockaddr*)m_socketAddr, (socklen_t*)&addr_length)) == -1)
 	{
-		fprintf(stderr, "Error: Receiving data %d\n", errno);
+		LOG_ERROR(LOG_CAT_IPC, "Error: Receiving data %d", errno);
 		return retValue;
 	}
 	else if (bytecount == 0)
-		printf("Connection closed\n");
+		LOG_INFO(LOG_CAT_IPC, "Connection closed");
 	*recv_value = buffer;
 	return IPC_RETURN_SUCCESS;
 }
 
 IPC_RETURN_TYPE FMUTCP::ReadData(void* pMemData, int iDataSize,int* readDataSize)
 {
-	int iResult = 0;
 	m_errorDescription.clear();
-	do {
-		iResult = receivefull((char*)pMemData, iDataSize, 0);
-		if (iResult > 0)
-		{
-            *readDataSize = iResult;
-			return IPC_RETURN_SUCCESS;
-		}
-		//printf("Bytes received: %d\n", iResult);
-		else if (iResult == 0)
-			printf("Connection closed\n");
-		else
-		{
-#ifdef  _WIN32
-			printf("recv failed with error: %d\n", WSAGetLastError());
-#elif __linux__
-            printf("recv failed with error: %d\n", errno);
-#endif
-			GetErrorMsgDescription(m_errorDescription);
-			printf("recv failed with error: %s\n", m_errorDescription.c_str());
-		}
+	if (m_sockfd == INVALID_SOCKET) {
+		m_errorDescription = "Socket Error: FMU socket invalid";
+		return IPC_RETURN_ERROR;
+	}
 
-	} while (iResult > 0);
+	int iResult = receivefull((char*)pMemData, iDataSize, 0);
+	if (iResult > 0)
+	{
+		*readDataSize = iResult;
+		return IPC_RETURN_SUCCESS;
+	}
+	else if (iResult == 0)
+	{
+		m_errorDescription = "Socket Error: connection closed";
+		LOG_INFO(LOG_CAT_IPC, "Connection closed");
+	}
+	else if (iResult == SOCKET_TIMEOUT)
+	{
+		m_errorDescription = "Socket Error: receive timed out";
+		return IPC_RETURN_TIMEOUT;
+	}
+	else
+	{
+		GetErrorMsgDescription(m_errorDescription);
+		LOG_ERROR(LOG_CAT_IPC, "recv failed with error: %s", m_errorDescription.c_str());
+	}
 	return IPC_RETURN_ERROR;
 }
 
@@ -459,24 +717,42 @@ void FMUUDP::GetErrorMsgDescription(std::string& errorMsg)
 
 int FMUTCP::WriteToSocket(void* buffer, int iDataSize, std::string& errorMsg)
 {
-	if (m_canSend)
+	if (m_canSend || m_sockfd == INVALID_SOCKET)
 		return SOCKET_ERROR;
 	
-	// Check whether the connection available.
-	int iResult = send(m_sockfd, (const char*)buffer, iDataSize /*(int)strlen(sendbuf)*/, MSG_NOSIGNAL);
-	if (iResult == SOCKET_ERROR) {
-		//printf("send failed with error: %d\n", WSAGetLastError());
-		GetErrorMsgDescription(errorMsg);
-#ifdef _WIN32
-		closesocket(m_sockfd);
-		WSACleanup();
-#elif __linux__
-        close(m_sockfd);
+	const char* bufPointer = (const char*)buffer;
+	int yetToWrite = iDataSize;
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	while (yetToWrite > 0)
+	{
+		int iResult = send(m_sockfd, bufPointer, yetToWrite, MSG_NOSIGNAL);
+		if (iResult > 0)
+		{
+			yetToWrite -= iResult;
+			bufPointer += iResult;
+			continue;
+		}
+#ifdef __linux__
+		if (iResult == SOCKET_ERROR && errno == EINTR)
+			continue;
+		if (iResult == SOCKET_ERROR && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			int ready = waitForSocket(EPOLLOUT, deadline);
+			if (ready == 0)
+			{
+				errorMsg = "Socket Error: send timed out";
+				return SOCKET_TIMEOUT;
+			}
+			if (ready > 0)
+				continue;
+		}
 #endif
-        return SOCKET_ERROR;
+		GetErrorMsgDescription(errorMsg);
+		CloseCommunication();
+		return SOCKET_ERROR;
 	}
 
-	return iResult;
+	return iDataSize;
 }
 
 int FMUUDP::WriteToSocket(void* buffer, int iDataSize, std::string& errorMsg)
@@ -490,9 +766,8 @@ int FMUUDP::WriteToSocket(void* buffer, int iDataSize, std::string& errorMsg)
 	// Check whether the connection available.
 	int iResult = sendto(m_sockfd, (const char*)buffer, iDataSize, 0, (struct sockaddr*)m_socketAddr, addr_length);
 	if (iResult == SOCKET_ERROR) {
-		printf("send failed with error: %d\n", IPC_ERROR);
 		GetErrorMsgDescription(errorMsg);
-		printf("send failed with error: %s\n", errorMsg.c_str());
+		LOG_ERROR(LOG_CAT_IPC, "send failed with error: %s", errorMsg.c_str());
 #ifdef _WIN32
 		closesocket(m_sockfd);
 		WSACleanup();
@@ -509,12 +784,29 @@ int FMUTCP::receivefull(void *buffer, size_t len, int flags)
 {
 	size_t yetToRead = len;
 	char  *bufPointer = (char*)buffer;
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
 
 	while (yetToRead > 0)
 	{
 		int received = recv(m_sockfd, bufPointer, static_cast<int>(yetToRead), flags);
-		if (received <= 0)
-			return received;     // We have error or the caller closed the connection
+		if (received < 0)
+		{
+#ifdef __linux__
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				int ready = waitForSocket(EPOLLIN, deadline);
+				if (ready == 0)
+					return SOCKET_TIMEOUT;
+				if (ready > 0)
+					continue;
+			}
+#endif
+			return received;     // We have an error
+		}
+		if (received == 0)
+			return received;     // The caller closed the connection
 
 		yetToRead -= received;   // Read remaining
 		bufPointer += received;  // Pointing to next buffer poistion
@@ -523,6 +815,71 @@ int FMUTCP::receivefull(void *buffer, size_t len, int flags)
 	return static_cast<int>(len);
 }
 
+std::chrono::steady_clock::time_point FMUTCP::makeDeadline() const
+{
+	if (m_timeoutMs < 0)
+	{
+		return std::chrono::steady_clock::time_point::max();
+	}
+	return std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+}
+
+#ifdef __linux__
+// Registers the socket for EPOLLIN, or switches an existing registration
+// back to it.
+bool FMUTCP::watchSocket()
+{
+	if (m_epollfd == INVALID_SOCKET)
+		return false;
+	if (m_epollEvents == EPOLLIN)
+		return true;
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = m_sockfd;
+	int op = m_epollEvents != 0 ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(m_epollfd, op, m_sockfd, &event) != 0)
+		return false;
+	m_epollEvents = EPOLLIN;
+	return true;
+}
+
+int FMUTCP::waitForSocket(uint32_t events, const std::chrono::steady_clock::time_point& deadline)
+{
+	if (m_epollEvents != events)
+	{
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = events;
+		event.data.fd = m_sockfd;
+		if (epoll_ctl(m_epollfd, EPOLL_CTL_MOD, m_sockfd, &event) != 0)
+			return SOCKET_ERROR;
+		m_epollEvents = events;
+	}
+
+	while (true)
+	{
+		int waitMs = -1;
+		if (deadline != std::chrono::steady_clock::time_point::max())
+		{
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			if (remaining < 0)
+				return 0;
+			waitMs = static_cast<int>(remaining);
+		}
+
+		epoll_event ready;
+		int rc = epoll_wait(m_epollfd, &ready, 1, waitMs);
+		if (rc > 0)
+			return 1;        // readiness or a socket error, the next call reports it
+		if (rc == 0)
+			return 0;
+		if (errno != EINTR)
+			return SOCKET_ERROR;
+	}
+}
+#endif
+
 void FMUTCP::CloseCommunication()
 {
 	if (m_sockfd != INVALID_SOCKET)
@@ -534,7 +891,9 @@ void FMUTCP::CloseCommunication()
 #elif __linux__
 		int how = SHUT_RDWR;
 		shutdown(m_sockfd,how);
+		// Closing the descriptor also drops it from the epoll set
 		close(m_sockfd);
+		m_epollEvents = 0;
 #endif
 		m_sockfd = INVALID_SOCKET;
 
@@ -18,6 +18,7 @@
 #include <sys/types.h>
 #include <netdb.h>
 #include <errno.h>
+#include <sys/epoll.h>
 #define SOCKET int
 #endif
 #include "Defines.h"
@@ -44,8 +45,12 @@ enum vINC_WARNINGS_ERRORS
 #include <memory>
 #include <vector>
 #include <map>
+#include <chrono>
 #include "BaseIPC.h"
 
+// TCP client of the tick channel. The socket is non-blocking and every
+// blocking call waits on an internal epoll set until the deadline given by
+// SetTimeout expires, so a stalled peer surfaces as IPC_RETURN_TIMEOUT.
 class FMUTCP :  public IBaseIPC {
 public:
 	FMUTCP();
@@ -54,16 +59,27 @@ public:
 	virtual IPC_RETURN_TYPE OpenCommunication() override;
 	virtual IPC_RETURN_TYPE WriteData(void* pMemData, int iDataSize) override;
 	virtual IPC_RETURN_TYPE ReadData(void* pMemData, int iDataSize,int* readDataSize) override;
+	virtual IPC_RETURN_TYPE WriteDataV(const IPCBuffer* pBuffers, int iBufferCount) override;
+	virtual IPC_RETURN_TYPE ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize) override;
     IPC_RETURN_TYPE ReadStatus(int* recv_value ) override;
 	virtual std::string getErrorDescription() override;
 	virtual void CloseCommunication() override;
 	virtual IPC_RETURN_TYPE waitForServerToClose() override;
+	virtual void SetTimeout(int iTimeoutMs) override { m_timeoutMs = iTimeoutMs; }
 	
 protected:
 	SOCKET         m_sockfd;
+	SOCKET         m_epollfd;
+	uint32_t       m_epollEvents;
+	int            m_timeoutMs;   // per call, -1 waits forever
 	std::string m_errorDescription;
 	int receivefull(void *buffer, size_t len, int flags);
 	static void GetErrorMsgDescription(std::string& errorMsg);
+	std::chrono::steady_clock::time_point makeDeadline() const;
+#ifdef __linux__
+	bool watchSocket();
+	int waitForSocket(uint32_t events, const std::chrono::steady_clock::time_point& deadline);
+#endif
 private:
     std::string m_portNum;
     std::string m_IP_Address;
@@ -82,6 +98,8 @@ public:
 	virtual IPC_RETURN_TYPE OpenCommunication() override;
 	virtual IPC_RETURN_TYPE WriteData(void* pMemData, int iDataSize) override;
 	virtual IPC_RETURN_TYPE ReadData(void* pMemData, int iDataSize, int* readDataSize) override = 0;
+	virtual IPC_RETURN_TYPE WriteDataV(const IPCBuffer* pBuffers, int iBufferCount) override;
+	virtual IPC_RETURN_TYPE ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize) override;
 	IPC_RETURN_TYPE ReadStatus(int* recv_value ) override;
 	virtual std::string getErrorDescription() override;
 	virtual void CloseCommunication() override;
@@ -1,286 +1,394 @@
-
 /*
+* FMUSharedMemory.cpp
+*
+*  POSIX shared memory transport for the tick channel, see FMUSharedMemory.h
+*  for the segment layout.
+*/
 
 #include "FMUSharedMemory.h"
 
-const DWORD CFMUSharedMemory::m_dwWaitTime = INFINITE;
-CFMUSharedMemory::CFMUSharedMemory() : m_pShMemClient (nullptr)
-, m_pShMemServer(nullptr)
-, m_hShMemClient(nullptr)
-, m_hShMemServer(nullptr)
-, m_hClientAvailable(nullptr)
-, m_hClientRead(nullptr)
-, m_hServerRead(nullptr)
-, m_hClientWrite(nullptr)
-, m_hServerWrite(nullptr)
-, m_hShmServerMutex(nullptr)
-, m_hShmClientMutex(nullptr)
-, m_strClientName(L"FMUSHAREDMEMCLIENT")
-, m_strServerName(L"FMUSHAREDMEMSERVER")
+#ifdef __linux__
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <algorithm>
+
+namespace
 {
+	// Busy-wait rounds before a waiting peer parks on the futex. A step round
+	// trip is a few microseconds when both sides are running; on a single CPU
+	// spinning only delays the peer, so we park right away.
+	const int SHM_SPIN_COUNT = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 4000 : 1;
+
+	// Upper bound of a single futex sleep, after which the peer state is
+	// re-checked so that a crashed peer does not block us forever.
+	const long long SHM_FUTEX_TIMEOUT_NS = 100 * 1000 * 1000;
+
+	// Interval at which OpenCommunication looks for the server's segment.
+	const int SHM_OPEN_RETRY_US = 1000;
+
+	inline void cpuRelax()
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#endif
+	}
 
+	inline uint32_t* futexWord(std::atomic<uint32_t>& word)
+	{
+		return reinterpret_cast<uint32_t*>(&word);
+	}
+
+	// Sleeps while word holds expected, at most until the deadline. Returns
+	// false without sleeping once the deadline has passed.
+	bool futexWait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::steady_clock::time_point deadline)
+	{
+		long long timeoutNs = SHM_FUTEX_TIMEOUT_NS;
+		if (deadline != std::chrono::steady_clock::time_point::max())
+		{
+			long long remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				deadline - std::chrono::steady_clock::now()).count();
+			if (remainingNs <= 0)
+			{
+				return false;
+			}
+			timeoutNs = std::min(timeoutNs, remainingNs);
+		}
+		struct timespec timeout;
+		timeout.tv_sec = timeoutNs / 1000000000;
+		timeout.tv_nsec = timeoutNs % 1000000000;
+		syscall(SYS_futex, futexWord(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+		return true;
+	}
+
+	void futexWake(std::atomic<uint32_t>& word)
+	{
+		syscall(SYS_futex, futexWord(word), FUTEX_WAKE, 0x7fffffff, nullptr, nullptr, 0);
+	}
+}
+
+CFMUSharedMemory::CFMUSharedMemory()
+	: m_pSegment(nullptr)
+	, m_strSegmentName("/FMUSHAREDMEM")
+	, m_timeoutMs(-1)
+{
 }
 
 CFMUSharedMemory::~CFMUSharedMemory()
 {
-ReleaseMutex(m_hShmClientMutex);
-UnmapViewOfFile(m_pShMemClient);
-CloseHandle(m_hShMemClient);
-UnmapViewOfFile(m_pShMemServer);
-CloseHandle(m_hShMemServer);
-CloseHandle(m_hClientAvailable);
-
-CloseHandle(m_hClientWrite);
-CloseHandle(m_hServerRead);
-CloseHandle(m_hClientRead);
-CloseHandle(m_hServerWrite);
-
-ReleaseMutex(m_hShmServerMutex);
-
-CloseHandle(m_hShmServerMutex);
-CloseHandle(m_hShmClientMutex);
+	CloseCommunication();
+	unmapSegment();
 }
 
 std::string CFMUSharedMemory::getErrorDescription()
 {
-return m_errorDescription;
+	return m_errorDescription;
 }
 
 IPC_RETURN_TYPE CFMUSharedMemory::InitCommunication(const std::string& strPortORFileName, const std::string& strIP_Address)
 {
-m_strSHMFieNameSuffix.assign(strPortORFileName.begin(), strPortORFileName.end());
-m_strClientName.append(L"_").append(m_strSHMFieNameSuffix);
-m_strServerName.append(L"_").append(m_strSHMFieNameSuffix);
-
-// Create the mutex
-wchar_t sClientMutex[MAX_PATH];
-wcscpy(sClientMutex, m_strClientName.c_str());
-wcscat(sClientMutex, L"ClientMutex");
-m_hShmClientMutex = CreateMutex(nullptr, FALSE, sClientMutex);
+	// The address is irrelevant for shared memory, the name selects the segment.
+	m_strSegmentName = std::string("/FMUSHAREDMEM_").append(strPortORFileName);
+	return IPC_RETURN_SUCCESS;
+}
 
-if (m_hShmClientMutex)
-{
-DWORD dwResult = WaitForSingleObject(m_hShmClientMutex, 0);
-if (dwResult != WAIT_OBJECT_0)
+std::chrono::steady_clock::time_point CFMUSharedMemory::makeDeadline() const
 {
-// Error waiting return false;
-CloseHandle(m_hShmClientMutex);
-return IPC_RETURN_ERROR;
+	if (m_timeoutMs < 0)
+	{
+		return std::chrono::steady_clock::time_point::max();
+	}
+	return std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeoutMs);
 }
+
+// Maps the segment if the server has created it with its full size. False
+// with an empty error description means it is not there yet.
+bool CFMUSharedMemory::mapSegment()
+{
+	int fd = shm_open(m_strSegmentName.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+		{
+			m_errorDescription = std::string("shm_open failed: ").append(strerror(errno));
+		}
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ShmSegment))
+	{
+		close(fd);
+		return false;
+	}
+
+	void* pMem = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pMem == MAP_FAILED)
+	{
+		m_errorDescription = std::string("mmap failed: ").append(strerror(errno));
+		return false;
+	}
+	m_pSegment = static_cast<ShmSegment*>(pMem);
+	return true;
 }
-else
+
+IPC_RETURN_TYPE CFMUSharedMemory::OpenCommunication()
 {
-// Some error
-return IPC_RETURN_ERROR;
+	unmapSegment();
+	m_errorDescription.clear();
+
+	// Like FMUTCP we wait until the server is up and has published the segment.
+	// A server restarting after a reset may unlink its old segment and create a
+	// new one under the same name, so a mapping that is not open yet is dropped
+	// and the name opened again rather than polling a stale segment.
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	while (true)
+	{
+		if (mapSegment())
+		{
+			if (m_pSegment->magic.load(std::memory_order_acquire) == SHM_SEGMENT_MAGIC &&
+				m_pSegment->serverState.load(std::memory_order_acquire) == SHM_PEER_OPEN)
+			{
+				break;
+			}
+			unmapSegment();
+		}
+		else if (!m_errorDescription.empty())
+		{
+			return IPC_RETURN_ERROR;
+		}
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			m_errorDescription = "Shared memory Error: timed out waiting for segment " + m_strSegmentName;
+			return IPC_RETURN_TIMEOUT;
+		}
+		usleep(SHM_OPEN_RETRY_US);
+	}
+	if (m_pSegment->version != SHM_SEGMENT_VERSION || m_pSegment->ringSize != SHM_RING_SIZE)
+	{
+		m_errorDescription = "shared memory segment layout mismatch";
+		unmapSegment();
+		return IPC_RETURN_ERROR;
+	}
+
+	m_pSegment->clientState.store(SHM_PEER_OPEN, std::memory_order_seq_cst);
+	futexWake(m_pSegment->clientState);
+	return IPC_RETURN_SUCCESS;
 }
 
-wchar_t sServerMemFile[MAX_PATH]; // Server mapping file we open this for write mode.
-wcscpy(sServerMemFile, m_strServerName.c_str());
-if ((m_hShMemServer = CreateFileMapping(INVALID_HANDLE_VALUE,
-nullptr,
-PAGE_READWRITE,
-0,
-sizeof(int) + IPC_PKT_DATA_SIZE,
-sServerMemFile)) != nullptr)
+bool CFMUSharedMemory::serverGone() const
 {
-if ((m_pShMemServer = (BYTE*)MapViewOfFile(m_hShMemServer,
-FILE_MAP_WRITE,
-0,
-0,
-IPC_PKT_DATA_SIZE + sizeof(int))) != nullptr)
+	return m_pSegment->serverState.load(std::memory_order_acquire) != SHM_PEER_OPEN;
+}
+
+IPC_RETURN_TYPE CFMUSharedMemory::writeRing(ShmRing& ring, const unsigned char* pData, uint32_t iDataSize)
 {
-wchar_t sServerWrite[MAX_PATH];
-wchar_t sClientRead[MAX_PATH];
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	uint32_t head = ring.head.load(std::memory_order_relaxed);
+	while (iDataSize > 0)
+	{
+		uint32_t tail = ring.tail.load(std::memory_order_acquire);
+		int spin = 0;
+		while (head - tail == SHM_RING_SIZE)
+		{
+			if (serverGone())
+			{
+				return IPC_RETURN_ERROR;
+			}
+			if (++spin < SHM_SPIN_COUNT)
+			{
+				cpuRelax();
+			}
+			else
+			{
+				ring.writerWaiting.store(1, std::memory_order_seq_cst);
+				if (ring.tail.load(std::memory_order_seq_cst) == tail && !futexWait(ring.tail, tail, deadline))
+				{
+					return IPC_RETURN_TIMEOUT;
+				}
+			}
+			tail = ring.tail.load(std::memory_order_acquire);
+		}
 
-wcscpy(sServerWrite, m_strServerName.c_str());
-wcscat(sServerWrite, L"ServerWrite");
-wcscpy(sClientRead, m_strClientName.c_str());
-wcscat(sClientRead, L"ClientRead");
+		uint32_t space = SHM_RING_SIZE - (head - tail);
+		uint32_t chunk = iDataSize < space ? iDataSize : space;
+		uint32_t offset = head & (SHM_RING_SIZE - 1);
+		uint32_t first = chunk < SHM_RING_SIZE - offset ? chunk : SHM_RING_SIZE - offset;
+		memcpy(ring.data + offset, pData, first);
+		memcpy(ring.data, pData + first, chunk - first);
 
-m_hClientRead = CreateEventW(nullptr, FALSE, TRUE, sClientRead);
-m_hServerWrite = CreateEventW(nullptr, FALSE, FALSE, sServerWrite);
+		head += chunk;
+		pData += chunk;
+		iDataSize -= chunk;
+		ring.head.store(head, std::memory_order_seq_cst);
+		if (ring.readerWaiting.exchange(0, std::memory_order_seq_cst))
+		{
+			futexWake(ring.head);
+		}
+	}
+	return IPC_RETURN_SUCCESS;
+}
 
+IPC_RETURN_TYPE CFMUSharedMemory::readRing(ShmRing& ring, unsigned char* pData, uint32_t iDataSize)
+{
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+	while (iDataSize > 0)
+	{
+		uint32_t head = ring.head.load(std::memory_order_acquire);
+		int spin = 0;
+		while (head == tail)
+		{
+			if (serverGone())
+			{
+				return IPC_RETURN_ERROR;
+			}
+			if (++spin < SHM_SPIN_COUNT)
+			{
+				cpuRelax();
+			}
+			else
+			{
+				ring.readerWaiting.store(1, std::memory_order_seq_cst);
+				if (ring.head.load(std::memory_order_seq_cst) == head && !futexWait(ring.head, head, deadline))
+				{
+					return IPC_RETURN_TIMEOUT;
+				}
+			}
+			head = ring.head.load(std::memory_order_acquire);
+		}
 
-// Notify the client saying the server is started.
-wchar_t sClientAvl[MAX_PATH];
-wcscpy(sClientAvl, m_strClientName.c_str());
-wcscat(sClientAvl, L"Avl");
-m_hClientAvailable = CreateEventW(nullptr, FALSE, FALSE, sClientAvl);
-SetEvent(m_hClientAvailable);
-return IPC_RETURN_SUCCESS;
+		uint32_t available = head - tail;
+		uint32_t chunk = iDataSize < available ? iDataSize : available;
+		uint32_t offset = tail & (SHM_RING_SIZE - 1);
+		uint32_t first = chunk < SHM_RING_SIZE - offset ? chunk : SHM_RING_SIZE - offset;
+		memcpy(pData, ring.data + offset, first);
+		memcpy(pData + first, ring.data, chunk - first);
+
+		tail += chunk;
+		pData += chunk;
+		iDataSize -= chunk;
+		ring.tail.store(tail, std::memory_order_seq_cst);
+		if (ring.writerWaiting.exchange(0, std::memory_order_seq_cst))
+		{
+			futexWake(ring.tail);
+		}
+	}
+	return IPC_RETURN_SUCCESS;
 }
-else
+
+IPC_RETURN_TYPE CFMUSharedMemory::WriteData(void* pMemData, int iDataSize)
 {
-// Failed to map the file
-}
-CloseHandle(m_hShMemServer);
+	if (m_pSegment == nullptr || iDataSize < 0)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	IPC_RETURN_TYPE ret = writeRing(m_pSegment->toServer, static_cast<const unsigned char*>(pMemData), (uint32_t)iDataSize);
+	if (ret == IPC_RETURN_TIMEOUT)
+	{
+		m_errorDescription = "Shared memory Error: timed out waiting for the server to read";
+	}
+	else if (ret != IPC_RETURN_SUCCESS)
+	{
+		m_errorDescription = "Shared memory Error: server closed the channel";
+	}
+	return ret;
 }
-else
+
+IPC_RETURN_TYPE CFMUSharedMemory::ReadData(void* pMemData, int iDataSize, int* readDataSize)
 {
-// Failed to create the file mapping
+	m_errorDescription.clear();
+	if (m_pSegment == nullptr || iDataSize < 0)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	IPC_RETURN_TYPE ret = readRing(m_pSegment->toClient, static_cast<unsigned char*>(pMemData), (uint32_t)iDataSize);
+	if (ret == IPC_RETURN_TIMEOUT)
+	{
+		m_errorDescription = "Shared memory Error: timed out waiting for the server";
+	}
+	else if (ret != IPC_RETURN_SUCCESS)
+	{
+		m_errorDescription = "Shared memory Error: server closed the channel";
+	}
+	else
+	{
+		*readDataSize = iDataSize;
+	}
+	return ret;
 }
 
-CloseHandle(m_hShmClientMutex);
-return IPC_RETURN_ERROR;
+IPC_RETURN_TYPE CFMUSharedMemory::ReadStatus(int* recv_value)
+{
+	int readSize = 0;
+	return ReadData(recv_value, sizeof(int), &readSize);
 }
 
-IPC_RETURN_TYPE CFMUSharedMemory::OpenCommunication()
-{
-// Create the mutex
-wchar_t sServerMutex[MAX_PATH];
-wcscpy(sServerMutex, m_strServerName.c_str());
-wcscat(sServerMutex, L"ServerMutex");
-m_hShmServerMutex = OpenMutex(MUTEX_ALL_ACCESS, FALSE, sServerMutex);
-if (m_hShmServerMutex)
+IPC_RETURN_TYPE CFMUSharedMemory::waitForServerToClose()
 {
+	if (m_pSegment == nullptr)
+	{
+		return IPC_RETURN_SUCCESS;
+	}
 
-DWORD dwResult = WaitForSingleObject(m_hShmServerMutex, 0);
-if (dwResult != WAIT_OBJECT_0)
-{
-// Error waiting return false;
-CloseHandle(m_hShmServerMutex);
-return false;
+	// Residual data is discarded until the server marks its side closed.
+	ShmRing& ring = m_pSegment->toClient;
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	while (true)
+	{
+		uint32_t state = m_pSegment->serverState.load(std::memory_order_acquire);
+		ring.tail.store(ring.head.load(std::memory_order_acquire), std::memory_order_release);
+		if (ring.writerWaiting.exchange(0))
+		{
+			futexWake(ring.tail);
+		}
+		if (state != SHM_PEER_OPEN)
+		{
+			break;
+		}
+		if (!futexWait(m_pSegment->serverState, state, deadline))
+		{
+			m_errorDescription = "Shared memory Error: timed out waiting for server to close";
+			return IPC_RETURN_TIMEOUT;
+		}
+	}
+	unmapSegment();
+	return IPC_RETURN_SUCCESS;
 }
-  }
-  else
-  {
-    // Some error
-    return IPC_RETURN_ERROR;
-  }
-
-  wchar_t sServerRead[MAX_PATH];
-  wchar_t sClientWrite[MAX_PATH];
-
-  wcscpy(sServerRead, m_strServerName.c_str());
-  wcscat(sServerRead, L"ServerRead");
-  wcscpy(sClientWrite, m_strClientName.c_str());
-  wcscat(sClientWrite, L"ClientWrite");
-
-  m_hServerRead = OpenEventW(EVENT_ALL_ACCESS, FALSE, sServerRead);
-  m_hClientWrite = OpenEventW(EVENT_ALL_ACCESS, FALSE, sClientWrite);
-
-  if (m_hServerRead == nullptr || m_hClientWrite == nullptr)
-  {
-    CloseHandle(m_hShmServerMutex);
-    return IPC_RETURN_ERROR;
-  }
-
-  wchar_t sClientMemFile[MAX_PATH]; // Server mapping file we open this for read only mode.
-  wcscpy(sClientMemFile, m_strClientName.c_str());
-
-  if ((m_hShMemClient = OpenFileMapping(FILE_MAP_READ,
-    FALSE,
-    sClientMemFile)) != nullptr)
-  {
-    if ((m_pShMemClient = (BYTE*)MapViewOfFile(m_hShMemClient,
-      FILE_MAP_READ,
-      0,
-      0,
-      IPC_PKT_DATA_SIZE + sizeof(int))) != nullptr)
-    {
-      // Is client avaialble
-      wchar_t sServerAvl[MAX_PATH];
-      wcscpy(sServerAvl, m_strServerName.c_str());
-      wcscat(sServerAvl, L"Avl");
-      HANDLE hServerAvailable = OpenEventW(EVENT_ALL_ACCESS, FALSE, sServerAvl);
-      if (WaitForSingleObject(hServerAvailable, 0) == WAIT_OBJECT_0)
-      {
-        CloseHandle(hServerAvailable);
-        return IPC_RETURN_SUCCESS;
-      }
-      CloseHandle(hServerAvailable);
-      UnmapViewOfFile(m_pShMemClient);
-    }
-    else
-    {
-      // Failed to map the file
-    }
-
-    CloseHandle(m_hShMemClient);
-  }
-  else
-  {
-    // Failed to open the file mapping
-  }
-
-  CloseHandle(m_hShmServerMutex);
-  return IPC_RETURN_ERROR;
+
+void CFMUSharedMemory::wakeAll()
+{
+	futexWake(m_pSegment->clientState);
+	futexWake(m_pSegment->toServer.head);
+	futexWake(m_pSegment->toServer.tail);
+	futexWake(m_pSegment->toClient.head);
+	futexWake(m_pSegment->toClient.tail);
 }
-IPC_RETURN_TYPE CFMUSharedMemory::WriteData(void* pMemData, int iDataSize)
+
+void CFMUSharedMemory::CloseCommunication()
 {
-  // Check whether the client has read the data.
-  HANDLE  hHandles[2];
-  hHandles[0] = m_hServerRead;
-  hHandles[1] = m_hShmServerMutex;
-  DWORD   dwResult = WaitForMultipleObjects(2, hHandles, FALSE, m_dwWaitTime);
-  switch (dwResult)
-  {
-  case WAIT_OBJECT_0:
-    if (iDataSize > IPC_PKT_DATA_SIZE)
-      return IPC_RETURN_ERROR;
-    // Data was read from the shared memory pool, write new data
-    // and notify any listener that new data was written.
-    memcpy(m_pShMemServer, pMemData, iDataSize);
-    SetEvent(m_hServerWrite);
-    return IPC_RETURN_SUCCESS;
-  case WAIT_OBJECT_0 + 1:
-    // The client has closd
-    // Release mutex as we have locked it
-    ReleaseMutex(m_hShmServerMutex);
-    return IPC_RETURN_ERROR;
-  case WAIT_ABANDONED_0 + 1:
-    // Something happened to the client.
-    ReleaseMutex(m_hShmServerMutex);
-    return IPC_RETURN_ERROR;
-  case WAIT_FAILED:
-    if (!m_hServerRead)
-      return IPC_RETURN_ERROR;
-    // Cause for strange failure
-    return IPC_RETURN_ERROR;
-  case WAIT_TIMEOUT:
-    // The client has not read the data we sent
-    return IPC_RETURN_ERROR;
-  }
-  return IPC_RETURN_ERROR;
+	// The mapping stays until waitForServerToClose or the next open, so the
+	// server's close can still be observed.
+	if (m_pSegment != nullptr &&
+		m_pSegment->clientState.load(std::memory_order_acquire) == SHM_PEER_OPEN)
+	{
+		m_pSegment->clientState.store(SHM_PEER_CLOSED, std::memory_order_seq_cst);
+		wakeAll();
+	}
 }
 
-IPC_RETURN_TYPE CFMUSharedMemory::ReadData(void* pMemData, int iDataSize)
+void CFMUSharedMemory::unmapSegment()
 {
-  // Check whether the client has read the data.
-  HANDLE  hHandles[2];
-  hHandles[0] = m_hClientWrite;
-  hHandles[1] = m_hShmServerMutex;
-  DWORD   dwResult = WaitForMultipleObjects(2, hHandles, FALSE, m_dwWaitTime);
-
-  switch (dwResult)
-  {
-  case WAIT_OBJECT_0:
-    if (iDataSize > IPC_PKT_DATA_SIZE)
-      return IPC_RETURN_ERROR;
-    // Data was read from the shared memory pool, write new data
-    // and notify any listener that new data was written.
-    memcpy(pMemData, m_pShMemClient, iDataSize);
-    SetEvent(m_hClientRead);
-    return IPC_RETURN_SUCCESS;
-  case WAIT_OBJECT_0 + 1:
-    // The client has closd
-    // Release mutex as we have locked it
-    ReleaseMutex(m_hShmServerMutex);
-    return IPC_RETURN_ERROR;
-  case WAIT_ABANDONED_0 + 1:
-    // Something happened to the client.
-    ReleaseMutex(m_hShmServerMutex);
-    return IPC_RETURN_ERROR;
-  case WAIT_FAILED:
-    if (!m_hClientWrite)
-      return IPC_RETURN_ERROR;
-
-    // Cause for strange failure
-    return IPC_RETURN_ERROR;
-  case WAIT_TIMEOUT:
-    // The Server has not read the data we sent
-    return IPC_RETURN_ERROR;
-  }
-  return IPC_RETURN_ERROR;
+	if (m_pSegment != nullptr)
+	{
+		munmap(m_pSegment, sizeof(ShmSegment));
+		m_pSegment = nullptr;
+	}
 }
-*/
\ No newline at end of file
+#endif
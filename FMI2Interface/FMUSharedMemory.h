@@ -1,10 +1,59 @@
 /*
+* FMUSharedMemory.h
+*
+*  POSIX shared memory transport for the tick channel.
+*
+*  The SIL controller (server) creates the segment "/FMUSHAREDMEM_<name>" with
+*  shm_open and lays out one ShmSegment in it. Each direction is a byte stream
+*  carried by a single-producer/single-consumer ring; waiting peers park on a
+*  futex instead of polling. The stream semantics match FMUTCP: WriteData
+*  appends bytes, ReadData/ReadStatus consume exactly the requested amount.
+*  Every blocking call gives up with IPC_RETURN_TIMEOUT once the deadline set
+*  by SetTimeout has passed.
+*/
 #pragma once
 
+#ifdef __linux__
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "BaseIPC.h"
-#include <winsock2.h>
 
-class CFMUSharedMemory : IBaseIPC
+const static uint32_t SHM_SEGMENT_MAGIC = 0x4D485346; // "FSHM"
+const static uint32_t SHM_SEGMENT_VERSION = 1;
+const static uint32_t SHM_RING_SIZE = 64 * 1024;      // must be a power of two
+
+typedef enum {
+	SHM_PEER_ABSENT = 0,
+	SHM_PEER_OPEN,
+	SHM_PEER_CLOSED
+} SHM_PEER_STATE;
+
+// One direction of the channel. head and tail are free running byte counters,
+// the producer only writes head and the consumer only writes tail.
+struct ShmRing {
+	std::atomic<uint32_t> head;
+	char pad0[60];
+	std::atomic<uint32_t> tail;
+	char pad1[60];
+	std::atomic<uint32_t> readerWaiting;  // consumer sleeps on head
+	std::atomic<uint32_t> writerWaiting;  // producer sleeps on tail
+	char pad2[56];
+	unsigned char data[SHM_RING_SIZE];
+};
+
+struct ShmSegment {
+	std::atomic<uint32_t> magic;          // published last by the creator
+	uint32_t version;
+	uint32_t ringSize;
+	std::atomic<uint32_t> serverState;    // SHM_PEER_STATE, futex word
+	std::atomic<uint32_t> clientState;    // SHM_PEER_STATE, futex word
+	char pad[44];
+	ShmRing toServer;                     // written by the harness
+	ShmRing toClient;                     // written by the SIL controller
+};
+
+class CFMUSharedMemory : public IBaseIPC
 {
 public:
 	CFMUSharedMemory();
@@ -13,28 +62,25 @@ public:
 	virtual IPC_RETURN_TYPE InitCommunication(const std::string& strPortORFileName, const std::string& strIP_Address) override;
 	virtual IPC_RETURN_TYPE OpenCommunication() override;
 	virtual IPC_RETURN_TYPE WriteData(void* pMemData, int iDataSize) override;
-	virtual IPC_RETURN_TYPE ReadData(void* pMemData, int iDataSize) override;
+	virtual IPC_RETURN_TYPE ReadData(void* pMemData, int iDataSize, int* readDataSize) override;
+	virtual IPC_RETURN_TYPE ReadStatus(int* recv_value) override;
+	virtual IPC_RETURN_TYPE waitForServerToClose() override;
 	virtual std::string getErrorDescription() override;
-
+	virtual void CloseCommunication() override;
+	virtual void SetTimeout(int iTimeoutMs) override { m_timeoutMs = iTimeoutMs; }
 
 private:
-	BYTE *m_pShMemClient;
-	BYTE *m_pShMemServer;
-
-	HANDLE m_hShMemClient;
-	HANDLE m_hShMemServer;
-	HANDLE m_hClientAvailable;
-	HANDLE m_hClientRead;   // Has client read?
-	HANDLE m_hServerRead;
-	HANDLE m_hClientWrite;
-	HANDLE m_hServerWrite;  // Server Write the data
-	HANDLE m_hShmServerMutex;
-	HANDLE m_hShmClientMutex;
-
-	std::wstring m_strClientName;
-	std::wstring m_strServerName;
+	ShmSegment* m_pSegment;
+	std::string m_strSegmentName;
 	std::string m_errorDescription;
-	std::wstring m_strSHMFieNameSuffix;
-	static const DWORD m_dwWaitTime;
+	int m_timeoutMs;   // per call, -1 waits forever
+
+	bool serverGone() const;
+	std::chrono::steady_clock::time_point makeDeadline() const;
+	bool mapSegment();
+	IPC_RETURN_TYPE writeRing(ShmRing& ring, const unsigned char* pData, uint32_t iDataSize);
+	IPC_RETURN_TYPE readRing(ShmRing& ring, unsigned char* pData, uint32_t iDataSize);
+	void wakeAll();
+	void unmapSegment();
 };
-*/
+#endif
@@ -0,0 +1,331 @@
+/*
+* FMUUnixSocket.cpp
+*
+*  AF_UNIX SOCK_SEQPACKET transport for the tick channel.
+*/
+
+#include "FMUUnixSocket.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+
+namespace
+{
+	// Upper bound of the buffers one record may be gathered from.
+	const int UNIX_MAX_IOV = 64;
+
+	// Longest pause between two connection attempts while the server is not up.
+	const int UNIX_MAX_RETRY_DELAY_US = 100 * 1000;
+
+	int toIoVec(iovec* iov, const IPCBuffer* pBuffers, int iBufferCount)
+	{
+		for (int i = 0; i < iBufferCount; ++i)
+		{
+			iov[i].iov_base = pBuffers[i].pData;
+			iov[i].iov_len = pBuffers[i].iDataSize;
+		}
+		return iBufferCount;
+	}
+}
+
+const char* const FMUUnix::DEFAULT_SOCKET_PATH = "/tmp/mockcanoe_tick.sock";
+
+FMUUnix::FMUUnix()
+	: m_sockfd(-1)
+	, m_timeoutMs(-1)
+	, m_socketPath(DEFAULT_SOCKET_PATH)
+{
+}
+
+FMUUnix::~FMUUnix()
+{
+	CloseCommunication();
+}
+
+IPC_RETURN_TYPE FMUUnix::InitCommunication(const std::string& strPortORFileName, const std::string& strIP_Address)
+{
+	// The file name is the socket path, the address is not used.
+	m_socketPath = strPortORFileName;
+	if (m_socketPath.size() >= sizeof(((sockaddr_un*)nullptr)->sun_path))
+	{
+		m_errorDescription = "Socket path too long: " + m_socketPath;
+		return IPC_RETURN_ERROR;
+	}
+	return IPC_RETURN_SUCCESS;
+}
+
+IPC_RETURN_TYPE FMUUnix::OpenCommunication()
+{
+	CloseCommunication();
+	m_errorDescription.clear();
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+	// Like FMUTCP we keep trying until the server is listening, backing off
+	// from 100 us up to UNIX_MAX_RETRY_DELAY_US until the deadline passes.
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	int retryDelayUs = 100;
+	while (true)
+	{
+		m_sockfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+		if (m_sockfd < 0)
+		{
+			GetErrorMsgDescription(m_errorDescription);
+			return IPC_RETURN_ERROR;
+		}
+		if (connect(m_sockfd, (sockaddr*)&addr, sizeof(addr)) == 0)
+		{
+			if (!applyTimeout())
+			{
+				GetErrorMsgDescription(m_errorDescription);
+				CloseCommunication();
+				return IPC_RETURN_ERROR;
+			}
+			return IPC_RETURN_SUCCESS;
+		}
+		int err = errno;
+		close(m_sockfd);
+		m_sockfd = -1;
+		if (err != ENOENT && err != ECONNREFUSED && err != EAGAIN)
+		{
+			errno = err;
+			GetErrorMsgDescription(m_errorDescription);
+			return IPC_RETURN_ERROR;
+		}
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			m_errorDescription = "Socket Error: timed out connecting to " + m_socketPath;
+			return IPC_RETURN_TIMEOUT;
+		}
+		usleep(retryDelayUs);
+		retryDelayUs = std::min(retryDelayUs * 2, UNIX_MAX_RETRY_DELAY_US);
+	}
+}
+
+void FMUUnix::SetTimeout(int iTimeoutMs)
+{
+	m_timeoutMs = iTimeoutMs;
+	if (m_sockfd >= 0)
+	{
+		applyTimeout();
+	}
+}
+
+// Blocking send and receive calls give up with EAGAIN after m_timeoutMs.
+bool FMUUnix::applyTimeout()
+{
+	timeval timeout;
+	timeout.tv_sec = m_timeoutMs < 0 ? 0 : m_timeoutMs / 1000;
+	timeout.tv_usec = m_timeoutMs < 0 ? 0 : (m_timeoutMs % 1000) * 1000;
+	if (m_timeoutMs == 0)
+	{
+		timeout.tv_usec = 1;    // a zero timeval would wait forever
+	}
+	return setsockopt(m_sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+		setsockopt(m_sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+// Describes the socket call that failed with errno, an expired timeout is
+// reported as IPC_RETURN_TIMEOUT.
+IPC_RETURN_TYPE FMUUnix::socketFailure()
+{
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+	{
+		m_errorDescription = "Socket Error: timed out waiting for the server";
+		return IPC_RETURN_TIMEOUT;
+	}
+	GetErrorMsgDescription(m_errorDescription);
+	return IPC_RETURN_ERROR;
+}
+
+IPC_RETURN_TYPE FMUUnix::WriteData(void* pMemData, int iDataSize)
+{
+	if (m_sockfd < 0)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	int iResult;
+	do {
+		iResult = send(m_sockfd, pMemData, iDataSize, MSG_NOSIGNAL);
+	} while (iResult < 0 && errno == EINTR);
+
+	if (iResult < 0)
+	{
+		return socketFailure();
+	}
+	if (iResult != iDataSize)
+	{
+		m_errorDescription = "Socket Error: record sent incompletely";
+		return IPC_RETURN_ERROR;
+	}
+	return IPC_RETURN_SUCCESS;
+}
+
+IPC_RETURN_TYPE FMUUnix::WriteDataV(const IPCBuffer* pBuffers, int iBufferCount)
+{
+	if (m_sockfd < 0 || iBufferCount > UNIX_MAX_IOV)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	iovec iov[UNIX_MAX_IOV];
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = toIoVec(iov, pBuffers, iBufferCount);
+
+	int iResult;
+	do {
+		iResult = sendmsg(m_sockfd, &msg, MSG_NOSIGNAL);
+	} while (iResult < 0 && errno == EINTR);
+
+	if (iResult < 0)
+	{
+		return socketFailure();
+	}
+	return IPC_RETURN_SUCCESS;
+}
+
+IPC_RETURN_TYPE FMUUnix::ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize)
+{
+	m_errorDescription.clear();
+	if (m_sockfd < 0 || iBufferCount > UNIX_MAX_IOV)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	iovec iov[UNIX_MAX_IOV];
+	int received = receiveRecord(iov, toIoVec(iov, pBuffers, iBufferCount));
+	if (received <= 0)
+	{
+		if (received < 0 && m_errorDescription.empty())
+		{
+			return socketFailure();
+		}
+		return IPC_RETURN_ERROR;
+	}
+	*readDataSize = received;
+	return IPC_RETURN_SUCCESS;
+}
+
+// Receives one record, a record larger than the buffers is an error.
+int FMUUnix::receiveRecord(iovec* iov, int iovCount)
+{
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovCount;
+
+	int received;
+	do {
+		received = recvmsg(m_sockfd, &msg, 0);
+	} while (received < 0 && errno == EINTR);
+
+	if (received > 0 && (msg.msg_flags & MSG_TRUNC))
+	{
+		m_errorDescription = "Socket Error: record larger than receive buffer";
+		return -1;
+	}
+	return received;
+}
+
+IPC_RETURN_TYPE FMUUnix::ReadData(void* pMemData, int iDataSize, int* readDataSize)
+{
+	m_errorDescription.clear();
+	if (m_sockfd < 0)
+	{
+		return IPC_RETURN_ERROR;
+	}
+	iovec iov;
+	iov.iov_base = pMemData;
+	iov.iov_len = iDataSize;
+	int received = receiveRecord(&iov, 1);
+	if (received <= 0)
+	{
+		if (received < 0 && m_errorDescription.empty())
+		{
+			return socketFailure();
+		}
+		return IPC_RETURN_ERROR;
+	}
+	*readDataSize = received;
+	return IPC_RETURN_SUCCESS;
+}
+
+IPC_RETURN_TYPE FMUUnix::ReadStatus(int* recv_value)
+{
+	int readSize = 0;
+	IPC_RETURN_TYPE ret = ReadData(recv_value, sizeof(int), &readSize);
+	if (ret == IPC_RETURN_SUCCESS && readSize != sizeof(int))
+	{
+		m_errorDescription = "Socket Error: status record has the wrong size";
+		return IPC_RETURN_ERROR;
+	}
+	return ret;
+}
+
+IPC_RETURN_TYPE FMUUnix::waitForServerToClose()
+{
+	if (m_sockfd < 0)
+	{
+		return IPC_RETURN_SUCCESS;
+	}
+
+	char buffer[1024];
+	std::chrono::steady_clock::time_point deadline = makeDeadline();
+	while (true)
+	{
+		int rc = recv(m_sockfd, buffer, sizeof(buffer), MSG_TRUNC);
+		if (rc == 0)
+		{
+			CloseCommunication();
+			return IPC_RETURN_SUCCESS;
+		}
+		else if (rc < 0 && errno != EINTR)
+		{
+			return socketFailure();
+		}
+		// Residual records are discarded, but only until the deadline
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			m_errorDescription = "Socket Error: timed out waiting for server to close";
+			return IPC_RETURN_TIMEOUT;
+		}
+	}
+}
+
+std::string FMUUnix::getErrorDescription()
+{
+	return m_errorDescription;
+}
+
+void FMUUnix::GetErrorMsgDescription(std::string& errorMsg)
+{
+	errorMsg = std::string("Socket Error: ").append(strerror(errno));
+}
+
+std::chrono::steady_clock::time_point FMUUnix::makeDeadline() const
+{
+	if (m_timeoutMs < 0)
+	{
+		return std::chrono::steady_clock::time_point::max();
+	}
+	return std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeoutMs);
+}
+
+void FMUUnix::CloseCommunication()
+{
+	if (m_sockfd >= 0)
+	{
+		shutdown(m_sockfd, SHUT_RDWR);
+		close(m_sockfd);
+		m_sockfd = -1;
+	}
+}
+#endif
@@ -0,0 +1,48 @@
+/*
+* FMUUnixSocket.h
+*
+*  AF_UNIX SOCK_SEQPACKET transport for the tick channel. Message boundaries
+*  are kept by the socket, so every WriteData arrives as one record and a
+*  read never returns a partial frame. The SetTimeout deadline is applied as
+*  SO_RCVTIMEO/SO_SNDTIMEO, so a stalled peer surfaces as IPC_RETURN_TIMEOUT.
+*/
+#pragma once
+
+#ifdef __linux__
+#include <sys/uio.h>
+#include <chrono>
+#include "BaseIPC.h"
+
+class FMUUnix : public IBaseIPC {
+public:
+	// Socket path used when no endpoint is configured
+	static const char* const DEFAULT_SOCKET_PATH;
+
+	FMUUnix();
+	virtual ~FMUUnix();
+	virtual IPC_RETURN_TYPE InitCommunication(const std::string& strPortORFileName, const std::string& strIP_Address) override;
+	virtual IPC_RETURN_TYPE OpenCommunication() override;
+	virtual IPC_RETURN_TYPE WriteData(void* pMemData, int iDataSize) override;
+	virtual IPC_RETURN_TYPE ReadData(void* pMemData, int iDataSize, int* readDataSize) override;
+	virtual IPC_RETURN_TYPE WriteDataV(const IPCBuffer* pBuffers, int iBufferCount) override;
+	virtual IPC_RETURN_TYPE ReadDataV(const IPCBuffer* pBuffers, int iBufferCount, int* readDataSize) override;
+	virtual IPC_RETURN_TYPE ReadStatus(int* recv_value) override;
+	virtual std::string getErrorDescription() override;
+	virtual void CloseCommunication() override;
+	virtual IPC_RETURN_TYPE waitForServerToClose() override;
+	virtual void SetTimeout(int iTimeoutMs) override;
+
+protected:
+	int m_sockfd;
+	int m_timeoutMs;   // per call, -1 waits forever
+	std::string m_errorDescription;
+	static void GetErrorMsgDescription(std::string& errorMsg);
+	std::chrono::steady_clock::time_point makeDeadline() const;
+
+private:
+	std::string m_socketPath;
+	int receiveRecord(iovec* iov, int iovCount);
+	bool applyTimeout();
+	IPC_RETURN_TYPE socketFailure();
+};
+#endif
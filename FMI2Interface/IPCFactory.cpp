@@ -1,6 +1,7 @@
 #include "IPCFactory.h"
-// #include "FMUSharedMemory.h"
+#include "FMUSharedMemory.h"
 #include "FMUIPC.h"
+#include "FMUUnixSocket.h"
 // #include "ProtoBufferTCP.h"
 // #include "FlatBufferIPC.h"
 
@@ -31,10 +32,19 @@ std::unique_ptr<IBaseIPC>IPCFactory::createIPCObject(IPC_TYPE ipcType)
 		// return std::unique_ptr<IBaseIPC>(new FlatBufferUDP());
 		break;
 	case IPC_SHARED_MEM:
-
-		// Shared memory is not supported as shared memory stream need to be validated.
-		//return std::unique_ptr<IBaseIPC>(new CFMUSharedMemory());
+#ifdef __linux__
+		return std::unique_ptr<IBaseIPC>(new CFMUSharedMemory());
+#else
+		// Shared memory is only implemented on top of POSIX shm and futexes.
+		return nullptr;
+#endif
+		break;
+	case IPC_UNIX:
+#ifdef __linux__
+		return std::unique_ptr<IBaseIPC>(new FMUUnix());
+#else
 		return nullptr;
+#endif
 		break;
 	default:
 		break;
@@ -9,6 +9,7 @@ typedef enum {
 	IPC_TCP_PROTOBUFFER,
 	IPC_SHARED_MEM,
 	IPC_UDP,
+	IPC_UNIX, // AF_UNIX SOCK_SEQPACKET, the port argument is the socket path
 	IPC_UNKNOWN
 } IPC_TYPE;
 
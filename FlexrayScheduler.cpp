@@ -0,0 +1,266 @@
+#include "FlexrayScheduler.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    bool parsePattern(const std::string& text, FlexrayScheduleEntry& entry)
+    {
+        if (text == "counter")
+        {
+            entry.counterPattern = true;
+            return true;
+        }
+        if (text.empty() || text.size() % 2 != 0 || text.size() > 2 * sizeof(entry.payload))
+        {
+            return false;
+        }
+        size_t patternLength = text.size() / 2;
+        for (size_t i = 0; i < patternLength; ++i)
+        {
+            char* end;
+            std::string byte = text.substr(2 * i, 2);
+            entry.payload[i] = static_cast<unsigned char>(strtoul(byte.c_str(), &end, 16));
+            if (*end != '\0')
+            {
+                return false;
+            }
+        }
+        for (size_t i = patternLength; i < sizeof(entry.payload); ++i)
+        {
+            entry.payload[i] = entry.payload[i % patternLength];
+        }
+        return true;
+    }
+
+    bool parseChannels(const std::string& text, uint8_t& mask)
+    {
+        if (text == "A") mask = FLEXRAY_CHANNEL_A;
+        else if (text == "B") mask = FLEXRAY_CHANNEL_B;
+        else if (text == "AB") mask = FLEXRAY_CHANNEL_A | FLEXRAY_CHANNEL_B;
+        else return false;
+        return true;
+    }
+
+    bool isPowerOfTwo(uint32_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+}
+
+FlexrayScheduler::FlexrayScheduler()
+    : m_cycleNs(0)
+    , m_staticSlots(0)
+    , m_staticSlotNs(0)
+    , m_minislots(0)
+    , m_minislotNs(0)
+    , m_tickPeriodNs(0)
+    , m_windowEndNs(0)
+    , m_cycle(0)
+    , m_row(0)
+    , m_maxFramesPerTick(0)
+    , m_framesEmitted(0)
+{
+    memset(m_cycleBegin, 0, sizeof(m_cycleBegin));
+}
+
+bool FlexrayScheduler::Load(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        m_errorDescription = std::string("Cannot open FlexRay schedule ").append(path);
+        return false;
+    }
+
+    // Channel bits per cycle and slot, to reject two frames in one slot
+    std::vector<uint8_t> used(CYCLE_COUNT * (MAX_SLOT + 1), 0);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first))
+        {
+            continue;
+        }
+
+        std::ostringstream error;
+        error << path << ":" << lineNumber << ": ";
+        if (first == "cluster")
+        {
+            double cycleUs, staticSlotUs, minislotUs;
+            if (!(fields >> cycleUs >> m_staticSlots >> staticSlotUs >> m_minislots >> minislotUs) ||
+                cycleUs <= 0 || staticSlotUs <= 0 || minislotUs < 0 ||
+                m_staticSlots == 0 || m_staticSlots + m_minislots > MAX_SLOT ||
+                m_staticSlots * staticSlotUs + m_minislots * minislotUs > cycleUs)
+            {
+                error << "expected cluster <cycle us> <static slots> <static slot us> <minislots> <minislot us> fitting into the cycle";
+                m_errorDescription = error.str();
+                return false;
+            }
+            m_cycleNs = static_cast<int64_t>(cycleUs * 1e3);
+            m_staticSlotNs = static_cast<int64_t>(staticSlotUs * 1e3);
+            m_minislotNs = static_cast<int64_t>(minislotUs * 1e3);
+            continue;
+        }
+        if (m_cycleNs == 0)
+        {
+            error << "frames must follow the cluster line";
+            m_errorDescription = error.str();
+            return false;
+        }
+
+        FlexrayScheduleEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        std::string channels, pattern;
+        char* end;
+        entry.slot = static_cast<uint32_t>(strtoul(first.c_str(), &end, 0));
+        bool valid = *end == '\0' &&
+            (fields >> channels >> entry.baseCycle >> entry.repetition >> entry.length >> pattern) &&
+            parseChannels(channels, entry.channelMask) &&
+            entry.slot >= 1 && entry.slot <= m_staticSlots + m_minislots &&
+            isPowerOfTwo(entry.repetition) && entry.repetition <= CYCLE_COUNT && entry.baseCycle < entry.repetition &&
+            entry.length <= FLEXRAY_MAX_PAYLOAD && parsePattern(pattern, entry);
+        if (!valid)
+        {
+            error << "expected <slot> <A|B|AB> <base cycle> <repetition> <length> <pattern> within the cluster";
+            m_errorDescription = error.str();
+            return false;
+        }
+        if (!addEntry(entry, used))
+        {
+            error << "slot " << entry.slot << " " << channels << " collides with an earlier frame";
+            m_errorDescription = error.str();
+            return false;
+        }
+    }
+    if (m_cycleNs == 0)
+    {
+        m_errorDescription = path + ": missing cluster line";
+        return false;
+    }
+    return true;
+}
+
+bool FlexrayScheduler::addEntry(const FlexrayScheduleEntry& entry, std::vector<uint8_t>& used)
+{
+    for (uint32_t cycle = entry.baseCycle; cycle < CYCLE_COUNT; cycle += entry.repetition)
+    {
+        if (used[cycle * (MAX_SLOT + 1) + entry.slot] & entry.channelMask)
+        {
+            return false;
+        }
+    }
+    for (uint32_t cycle = entry.baseCycle; cycle < CYCLE_COUNT; cycle += entry.repetition)
+    {
+        used[cycle * (MAX_SLOT + 1) + entry.slot] |= entry.channelMask;
+    }
+    m_entries.push_back(entry);
+    return true;
+}
+
+int64_t FlexrayScheduler::slotOffsetNs(uint32_t slot) const
+{
+    if (slot <= m_staticSlots)
+    {
+        return (slot - 1) * m_staticSlotNs;
+    }
+    return m_staticSlots * m_staticSlotNs + (slot - m_staticSlots - 1) * m_minislotNs;
+}
+
+void FlexrayScheduler::Start(int64_t tickPeriodNs)
+{
+    m_tickPeriodNs = tickPeriodNs > 0 ? tickPeriodNs : 1;
+    m_windowEndNs = 0;
+    m_cycle = 0;
+    m_framesEmitted = 0;
+    m_counters.assign(m_entries.size(), 0);
+
+    m_table.clear();
+    size_t maxPerCycle = 0;
+    for (int cycle = 0; cycle < CYCLE_COUNT; ++cycle)
+    {
+        m_cycleBegin[cycle] = static_cast<uint32_t>(m_table.size());
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const FlexrayScheduleEntry& entry = m_entries[i];
+            if (static_cast<uint32_t>(cycle) % entry.repetition == entry.baseCycle)
+            {
+                Scheduled row = { slotOffsetNs(entry.slot), static_cast<int32_t>(i) };
+                m_table.push_back(row);
+            }
+        }
+        std::stable_sort(m_table.begin() + m_cycleBegin[cycle], m_table.end(),
+                         [](const Scheduled& a, const Scheduled& b) { return a.offsetNs < b.offsetNs; });
+        maxPerCycle = std::max(maxPerCycle, m_table.size() - m_cycleBegin[cycle]);
+    }
+    m_cycleBegin[CYCLE_COUNT] = static_cast<uint32_t>(m_table.size());
+    m_row = m_cycleBegin[0];
+
+    // A window touches at most the cycles it covers plus a partial one at
+    // each end
+    size_t cyclesPerTick = m_cycleNs > 0 ? static_cast<size_t>(m_tickPeriodNs / m_cycleNs) + 2 : 0;
+    m_maxFramesPerTick = maxPerCycle * cyclesPerTick;
+}
+
+void FlexrayScheduler::CollectTick(std::vector<FlexrayFrame>& frames)
+{
+    m_windowEndNs += m_tickPeriodNs;
+    if (m_cycleNs == 0)
+    {
+        return;
+    }
+    for (;;)
+    {
+        int64_t cycleStartNs = static_cast<int64_t>(m_cycle) * m_cycleNs;
+        if (cycleStartNs >= m_windowEndNs)
+        {
+            return;
+        }
+        uint32_t cycle = static_cast<uint32_t>(m_cycle & (CYCLE_COUNT - 1));
+        for (; m_row < m_cycleBegin[cycle + 1]; ++m_row)
+        {
+            const Scheduled& row = m_table[m_row];
+            int64_t timestampNs = cycleStartNs + row.offsetNs;
+            if (timestampNs >= m_windowEndNs)
+            {
+                return;
+            }
+
+            const FlexrayScheduleEntry& entry = m_entries[row.entry];
+            frames.resize(frames.size() + 1);
+            FlexrayFrame& frame = frames.back();
+            frame.timestamp_ns = timestampNs;
+            frame.slot = static_cast<uint16_t>(entry.slot);
+            frame.cycle = static_cast<uint8_t>(cycle);
+            frame.channelMask = entry.channelMask;
+            frame.length = static_cast<uint8_t>(entry.length);
+            if (entry.counterPattern)
+            {
+                uint32_t counter = m_counters[row.entry]++;
+                for (uint32_t j = 0; j < entry.length; ++j)
+                {
+                    frame.payload[j] = static_cast<unsigned char>(counter + j);
+                }
+            }
+            else
+            {
+                memcpy(frame.payload, entry.payload, entry.length);
+            }
+            m_framesEmitted++;
+        }
+        ++m_cycle;
+        m_row = m_cycleBegin[m_cycle & (CYCLE_COUNT - 1)];
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MockMessages.h"
+
+// One frame of the FlexRay schedule, sent in `slot` of every cycle c with
+// c % repetition == baseCycle (cycle multiplexing).
+struct FlexrayScheduleEntry
+{
+    uint32_t slot;
+    uint8_t channelMask;
+    uint32_t baseCycle;
+    uint32_t repetition;        // 1, 2, 4, ... 64
+    uint32_t length;
+    bool counterPattern;        // payload byte j = counter + j
+    unsigned char payload[FLEXRAY_MAX_PAYLOAD];
+};
+
+// Emits the frames of a FlexRay cluster schedule.
+//
+// A communication cycle starts with the static segment of equally long
+// slots, followed by the dynamic segment of minislots; dynamic slot s is
+// sent at minislot s - staticSlots - 1. The cluster runs through cycles
+// 0..63 and repeats. Start() flattens the schedule into one table sorted by
+// cycle and offset, with the first row of every cycle indexed directly, so
+// a tick costs one step per emitted frame regardless of the schedule size.
+class FlexrayScheduler
+{
+public:
+    static const int CYCLE_COUNT = 64;
+    static const uint32_t MAX_SLOT = 2047;
+
+    FlexrayScheduler();
+
+    // cluster <cycle us> <static slots> <static slot us> <minislots> <minislot us>
+    // <slot> <A|B|AB> <base cycle> <repetition> <length> <pattern>
+    // pattern is a hex byte string repeated over the payload, or "counter".
+    bool Load(const std::string& path);
+
+    void Start(int64_t tickPeriodNs);
+
+    // Appends the frames due in the current tick window and advances one tick.
+    void CollectTick(std::vector<FlexrayFrame>& frames);
+
+    // Upper bound of the frames one tick can emit, valid after Start().
+    size_t MaxFramesPerTick() const { return m_maxFramesPerTick; }
+    size_t EntryCount() const { return m_entries.size(); }
+    uint64_t FramesEmitted() const { return m_framesEmitted; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    struct Scheduled
+    {
+        int64_t offsetNs;           // from the start of the cycle
+        int32_t entry;
+    };
+
+    bool addEntry(const FlexrayScheduleEntry& entry, std::vector<uint8_t>& used);
+    int64_t slotOffsetNs(uint32_t slot) const;
+
+    int64_t m_cycleNs;
+    uint32_t m_staticSlots;
+    int64_t m_staticSlotNs;
+    uint32_t m_minislots;
+    int64_t m_minislotNs;
+
+    std::vector<FlexrayScheduleEntry> m_entries;
+    std::vector<uint32_t> m_counters;
+    std::vector<Scheduled> m_table;
+    uint32_t m_cycleBegin[CYCLE_COUNT + 1];   // rows of cycle c: [m_cycleBegin[c], m_cycleBegin[c + 1])
+
+    int64_t m_tickPeriodNs;
+    int64_t m_windowEndNs;
+    uint64_t m_cycle;               // absolute cycle counter
+    uint32_t m_row;                 // next row of the current cycle
+    size_t m_maxFramesPerTick;
+    uint64_t m_framesEmitted;
+    std::string m_errorDescription;
+};
@@ -0,0 +1,318 @@
+#include "FrameCapture.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <chrono>
+#include "AsyncLogger.h"
+#include "EthFramePool.h"
+
+namespace
+{
+    // Pause of the flusher when the ring is empty.
+    const int CAPTURE_IDLE_SLEEP_US = 1000;
+
+    // Largest payload kept per frame kind, a longer array is truncated.
+    size_t maxPayload(CaptureFrameKind kind)
+    {
+        switch (kind)
+        {
+        case CAPTURE_CAN: return 64;
+        case CAPTURE_FLEXRAY: return 254;
+        case CAPTURE_ETH_INJECTED: return ETH_MAX_PAYLOAD;
+        default: return 9216;
+        }
+    }
+
+    const char* const captureSignatures[CAPTURE_KIND_COUNT] = {
+        CAPTURE_CAN_SIGNATURE, CAPTURE_ETH_SIGNATURE, CAPTURE_FLEXRAY_SIGNATURE, CAPTURE_ETH_INJECTED_SIGNATURE
+    };
+
+    int64_t monotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+}
+
+FrameCapture::FrameCapture()
+    : m_fd(-1)
+    , m_ring(nullptr)
+    , m_head(0)
+    , m_tail(0)
+    , m_map(nullptr)
+    , m_mapOffset(0)
+    , m_fileSize(0)
+    , m_records(0)
+    , m_dropped(0)
+    , m_running(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    Close();
+}
+
+bool FrameCapture::Open(const std::string& path)
+{
+    Close();
+    m_errorDescription.clear();
+
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | O_LARGEFILE, 0644);
+    if (m_fd < 0)
+    {
+        m_errorDescription = std::string("Cannot create capture ").append(path).append(": ").append(strerror(errno));
+        return false;
+    }
+    m_ring = new unsigned char[RING_SIZE];
+    m_head = 0;
+    m_tail = 0;
+    m_fileSize = 0;
+    m_records = 0;
+    m_dropped = 0;
+
+    CaptureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CAPTURE_FILE_MAGIC;
+    header.version = CAPTURE_FILE_VERSION;
+    for (int i = 0; i < CAPTURE_KIND_COUNT; ++i)
+    {
+        strncpy(header.signatures[i], captureSignatures[i], sizeof(header.signatures[i]) - 1);
+    }
+    if (!writeFile(reinterpret_cast<const unsigned char*>(&header), sizeof(header)))
+    {
+        Close();
+        return false;
+    }
+
+    m_running = true;
+    m_flusher = std::thread(&FrameCapture::run, this);
+    return true;
+}
+
+void FrameCapture::Close()
+{
+    if (m_flusher.joinable())
+    {
+        m_running = false;
+        m_flusher.join();
+    }
+    if (m_map != nullptr)
+    {
+        munmap(m_map, MAP_CHUNK_SIZE);
+        m_map = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        // Cut the preallocated tail of the last chunk
+        if (ftruncate64(m_fd, static_cast<off64_t>(m_fileSize)) != 0)
+        {
+            LOG_ERROR(LOG_CAT_CAPL, "Cannot truncate capture: %s", strerror(errno));
+        }
+        close(m_fd);
+        m_fd = -1;
+    }
+    delete[] m_ring;
+    m_ring = nullptr;
+}
+
+void FrameCapture::CaptureEthFrame(const EthFrame* frame)
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    CaptureRecord record;
+    record.Add(static_cast<unsigned long>(frame->channel));
+    record.Add(static_cast<unsigned long>(frame->direction));
+    record.Add(static_cast<unsigned long long>(frame->timestamp_ns));
+    record.Add(static_cast<unsigned long>(frame->length));
+    enqueue(CAPTURE_ETH_INJECTED, record, frame);
+}
+
+void FrameCapture::enqueue(CaptureFrameKind kind, CaptureRecord& record, const EthFrame* reference)
+{
+    size_t payloadSize = 0;
+    if (reference != nullptr)
+    {
+        payloadSize = reference->length < maxPayload(kind) ? reference->length : maxPayload(kind);
+    }
+    else if (record.payload != nullptr)
+    {
+        payloadSize = record.payloadLimit < maxPayload(kind) ? static_cast<size_t>(record.payloadLimit) : maxPayload(kind);
+    }
+    size_t recordSize = record.size + payloadSize;
+
+    CaptureRecordHeader* header = reinterpret_cast<CaptureRecordHeader*>(record.buffer);
+    header->recordSize = static_cast<uint32_t>(recordSize);
+    header->timestampNs = monotonicNs();
+    header->kind = static_cast<uint8_t>(kind);
+    header->paramCount = static_cast<uint8_t>(record.paramCount);
+    header->payloadSize = static_cast<uint16_t>(payloadSize);
+
+    // A referenced payload stays in its pool buffer, the ring only holds the
+    // pointer to it.
+    const unsigned char* payload = record.payload;
+    size_t ringPayloadSize = payloadSize;
+    if (reference != nullptr)
+    {
+        header->kind |= KIND_BY_REFERENCE;
+        payload = reinterpret_cast<const unsigned char*>(&reference);
+        ringPayloadSize = sizeof(reference);
+    }
+    size_t ringSize = record.size + ringPayloadSize;
+
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    uint64_t tail = m_tail.load(std::memory_order_acquire);
+    if (RING_SIZE - (head - tail) < ringSize)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (reference != nullptr)
+    {
+        EthFramePool::AddRef(reference);
+    }
+
+    size_t offset = static_cast<size_t>(head & (RING_SIZE - 1));
+    const unsigned char* parts[2] = { record.buffer, payload };
+    size_t partSizes[2] = { record.size, ringPayloadSize };
+    for (int i = 0; i < 2; ++i)
+    {
+        size_t first = partSizes[i] < RING_SIZE - offset ? partSizes[i] : RING_SIZE - offset;
+        memcpy(m_ring + offset, parts[i], first);
+        memcpy(m_ring, parts[i] + first, partSizes[i] - first);
+        offset = (offset + partSizes[i]) & (RING_SIZE - 1);
+    }
+    m_head.store(head + ringSize, std::memory_order_release);
+    m_records.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameCapture::copyFromRing(uint64_t position, void* data, size_t size) const
+{
+    size_t offset = static_cast<size_t>(position & (RING_SIZE - 1));
+    size_t first = size < RING_SIZE - offset ? size : RING_SIZE - offset;
+    memcpy(data, m_ring + offset, first);
+    memcpy(static_cast<unsigned char*>(data) + first, m_ring, size - first);
+}
+
+// Writes size ring bytes starting at position to the file.
+void FrameCapture::writeRing(uint64_t position, size_t size)
+{
+    while (size > 0)
+    {
+        size_t offset = static_cast<size_t>(position & (RING_SIZE - 1));
+        size_t chunk = size < RING_SIZE - offset ? size : RING_SIZE - offset;
+        if (!writeFile(m_ring + offset, chunk))
+        {
+            // Keep draining so the producer does not see a full ring forever
+            LOG_ERROR(LOG_CAT_CAPL, "%s", m_errorDescription.c_str());
+        }
+        position += chunk;
+        size -= chunk;
+    }
+}
+
+bool FrameCapture::mapChunk(uint64_t offset)
+{
+    if (m_map != nullptr)
+    {
+        munmap(m_map, MAP_CHUNK_SIZE);
+        m_map = nullptr;
+    }
+    if (ftruncate64(m_fd, static_cast<off64_t>(offset + MAP_CHUNK_SIZE)) != 0)
+    {
+        m_errorDescription = std::string("Cannot grow capture: ").append(strerror(errno));
+        return false;
+    }
+    void* map = mmap64(nullptr, MAP_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off64_t>(offset));
+    if (map == MAP_FAILED)
+    {
+        m_errorDescription = std::string("mmap of capture failed: ").append(strerror(errno));
+        return false;
+    }
+    m_map = static_cast<unsigned char*>(map);
+    m_mapOffset = offset;
+    return true;
+}
+
+bool FrameCapture::writeFile(const unsigned char* data, size_t size)
+{
+    while (size > 0)
+    {
+        if (m_map == nullptr || m_fileSize >= m_mapOffset + MAP_CHUNK_SIZE)
+        {
+            if (!mapChunk(m_fileSize))
+            {
+                return false;
+            }
+        }
+        size_t offset = static_cast<size_t>(m_fileSize - m_mapOffset);
+        size_t chunk = size < MAP_CHUNK_SIZE - offset ? size : MAP_CHUNK_SIZE - offset;
+        memcpy(m_map + offset, data, chunk);
+        m_fileSize += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+// Moves everything queued so far into the file, returns false when idle.
+// Runs of inline records are written as they lie in the ring, a record by
+// reference is written from its pool buffer and releases it.
+bool FrameCapture::flushRing()
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    uint64_t runStart = tail;
+    while (tail != head)
+    {
+        CaptureRecordHeader header;
+        copyFromRing(tail, &header, sizeof(header));
+        if ((header.kind & KIND_BY_REFERENCE) == 0)
+        {
+            tail += header.recordSize;
+            continue;
+        }
+        writeRing(runStart, static_cast<size_t>(tail - runStart));
+
+        unsigned char record[sizeof(CaptureRecordHeader) + MAX_PARAMS * sizeof(uint64_t)];
+        size_t inlineSize = header.recordSize - header.payloadSize;
+        copyFromRing(tail, record, inlineSize);
+        reinterpret_cast<CaptureRecordHeader*>(record)->kind = header.kind & ~KIND_BY_REFERENCE;
+        const EthFrame* frame;
+        copyFromRing(tail + inlineSize, &frame, sizeof(frame));
+        if (!writeFile(record, inlineSize) || !writeFile(frame->Data(), header.payloadSize))
+        {
+            LOG_ERROR(LOG_CAT_CAPL, "%s", m_errorDescription.c_str());
+        }
+        EthFramePool::Release(frame);
+
+        tail += inlineSize + sizeof(frame);
+        runStart = tail;
+        m_tail.store(tail, std::memory_order_release);
+    }
+    writeRing(runStart, static_cast<size_t>(tail - runStart));
+    m_tail.store(tail, std::memory_order_release);
+    return true;
+}
+
+void FrameCapture::run()
+{
+    while (m_running.load(std::memory_order_acquire))
+    {
+        if (!flushRing())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(CAPTURE_IDLE_SLEEP_US));
+        }
+    }
+    flushRing();
+}
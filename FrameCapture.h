@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "MockMessages.h"
+
+// Frame kinds of the capture file, one per CALLBACK_Write*Frame plus the
+// Ethernet frames injected into the DLL.
+enum CaptureFrameKind
+{
+    CAPTURE_CAN = 1,
+    CAPTURE_ETH = 2,
+    CAPTURE_FLEXRAY = 3,
+    CAPTURE_ETH_INJECTED = 4
+};
+
+const int CAPTURE_KIND_COUNT = 4;
+
+// CAPL parameter signatures of CALLBACK_WriteCanFrame, CALLBACK_WriteEthFrame
+// and CALLBACK_WriteFlexrayFrame. Injected Ethernet frames are stored as
+// channel, direction, timestamp, length and payload.
+constexpr const char* CAPTURE_CAN_SIGNATURE = "DDDDDDDDDDB";
+constexpr const char* CAPTURE_ETH_SIGNATURE = "DUUDDDB";
+constexpr const char* CAPTURE_FLEXRAY_SIGNATURE = "DDDDDDBDD";
+constexpr const char* CAPTURE_ETH_INJECTED_SIGNATURE = "DDUDB";
+
+const uint32_t CAPTURE_FILE_MAGIC = 0x5041434D;     // "MCAP"
+const uint32_t CAPTURE_FILE_VERSION = 2;
+
+#pragma pack(push, 1)
+// Start of the capture file, followed by the records.
+struct CaptureFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    char signatures[CAPTURE_KIND_COUNT][16];    // parameter signature per CaptureFrameKind - 1
+};
+
+// Every record is this header, the scalar parameters in signature order
+// ('D'/'L' as 4 bytes, 'U' as 8 bytes) and then the byte array payload.
+struct CaptureRecordHeader
+{
+    uint32_t recordSize;        // including this header
+    int64_t timestampNs;        // CLOCK_MONOTONIC at capture
+    uint8_t kind;               // CaptureFrameKind
+    uint8_t paramCount;         // scalar parameters
+    uint16_t payloadSize;
+};
+#pragma pack(pop)
+
+// Captures the frames the CAPL DLL transmits into an append-only binary
+// file. The tick thread only encodes a record into a preallocated ring;
+// a background thread moves the ring into the file through a sliding
+// shared mapping that grows in MAP_CHUNK_SIZE steps. A full ring drops the
+// record instead of stalling the tick. Pooled Ethernet frames are queued by
+// reference and their payload is written straight from the pool buffer.
+class FrameCapture
+{
+public:
+    static const size_t RING_SIZE = 8 * 1024 * 1024;    // must be a power of two
+    static const size_t MAP_CHUNK_SIZE = 16 * 1024 * 1024;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_fd >= 0; }
+
+    // Queues one record of a transmit callback. Scalars are stored in
+    // argument order, a byte array is sized by the scalar in front of it.
+    template <typename... Args>
+    void CaptureFrame(CaptureFrameKind kind, Args... args)
+    {
+        if (m_fd < 0)
+        {
+            return;
+        }
+        CaptureRecord record;
+        int expand[] = { 0, (record.Add(args), 0)... };
+        (void)expand;
+        enqueue(kind, record);
+    }
+
+    // Queues an injected frame, holding a pool reference until it is written.
+    void CaptureEthFrame(const EthFrame* frame);
+
+    uint64_t RecordsCaptured() const { return m_records.load(std::memory_order_relaxed); }
+    uint64_t RecordsDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t BytesWritten() const { return m_fileSize; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    static const int MAX_PARAMS = 16;
+
+    // Header and scalars of a record encoded on the stack, the payload is
+    // copied straight from the caller's array into the ring.
+    struct CaptureRecord
+    {
+        unsigned char buffer[sizeof(CaptureRecordHeader) + MAX_PARAMS * sizeof(uint64_t)];
+        size_t size;
+        int paramCount;
+        uint64_t lastScalar;
+        const unsigned char* payload;
+        uint64_t payloadLimit;
+
+        CaptureRecord()
+            : size(sizeof(CaptureRecordHeader)), paramCount(0), lastScalar(0), payload(nullptr), payloadLimit(0) {}
+
+        void Add(unsigned long value) { addScalar(static_cast<uint32_t>(value), value); }
+        void Add(long value) { addScalar(static_cast<uint32_t>(value), static_cast<uint64_t>(value)); }
+        void Add(unsigned long long value) { addScalar(static_cast<uint64_t>(value), value); }
+        void Add(unsigned char* bytes)
+        {
+            payload = bytes;
+            payloadLimit = lastScalar;
+        }
+
+        template <typename T>
+        void addScalar(T stored, uint64_t value)
+        {
+            if (paramCount < MAX_PARAMS)
+            {
+                memcpy(buffer + size, &stored, sizeof(stored));
+                size += sizeof(stored);
+                paramCount++;
+            }
+            lastScalar = value;
+        }
+    };
+
+    // Set on CaptureRecordHeader::kind inside the ring only: the record is
+    // followed by an EthFrame pointer instead of its payload.
+    static const uint8_t KIND_BY_REFERENCE = 0x80;
+
+    void enqueue(CaptureFrameKind kind, CaptureRecord& record, const EthFrame* reference = nullptr);
+    void copyFromRing(uint64_t position, void* data, size_t size) const;
+    void writeRing(uint64_t position, size_t size);
+
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator=(const FrameCapture&);
+
+    void run();
+    bool flushRing();
+    bool writeFile(const unsigned char* data, size_t size);
+    bool mapChunk(uint64_t offset);
+
+    int m_fd;
+    unsigned char* m_ring;
+    std::atomic<uint64_t> m_head;       // written by the tick thread
+    std::atomic<uint64_t> m_tail;       // written by the flusher
+
+    unsigned char* m_map;
+    uint64_t m_mapOffset;
+    uint64_t m_fileSize;
+
+    std::atomic<uint64_t> m_records;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<bool> m_running;
+    std::thread m_flusher;
+    std::string m_errorDescription;
+};
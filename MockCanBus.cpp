@@ -0,0 +1,267 @@
+#include "MockCanBus.h"
+
+namespace
+{
+    const uint64_t EMPTY_KEY = ~0ull;
+
+    // Request handles are slab indices + 1, never dereferenced
+    VIARequestHandle toHandle(size_t index)
+    {
+        return reinterpret_cast<VIARequestHandle>(static_cast<uintptr_t>(index + 1));
+    }
+
+    size_t fromHandle(VIARequestHandle handle)
+    {
+        return static_cast<size_t>(reinterpret_cast<uintptr_t>(handle)) - 1;
+    }
+}
+
+const VIAChannel MockCanBus::MAX_CHANNEL;
+const int32_t MockCanBus::NO_REQUEST;
+const uint32_t MockCanBus::STANDARD_IDS;
+const size_t MockCanBus::WILDCARD_SLOT;
+
+MockCanBus::MockCanBus()
+    : m_extendedUsed(0)
+    , m_liveRequests(0)
+    , m_online(true)
+    , m_deliveries(0)
+{
+    Reset();
+}
+
+VIAResult MockCanBus::GetVersion(uint32* busInterfaceType, int32* majorversion, int32* minorversion)
+{
+    *busInterfaceType = kVIA_CAN;
+    *majorversion = CAN_BUS_MAJOR_VERSION;
+    *minorversion = CAN_BUS_MINOR_VERSION;
+    return kVIA_OK;
+}
+
+VIAResult MockCanBus::GetNumberOfChannels(VIAChannel* maxChannelNumber)
+{
+    *maxChannelNumber = MAX_CHANNEL;
+    return kVIA_OK;
+}
+
+// Offline stops the delivery to the sinks, the DLL keeps getting its frames
+// through setCanFrame.
+VIAResult MockCanBus::SetLine(VIAChannel channel, uint32 mode, uint32 part32)
+{
+    if (channel != kVIA_WildcardChannel)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    m_online = (mode & kVIA_Online) != 0;
+    return kVIA_OK;
+}
+
+VIAResult MockCanBus::CreateMessageRequest(VIARequestHandle* handle, CanMessageSink* sink, VIAChannel channel, uint32 id)
+{
+    if (handle == nullptr || sink == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    *handle = nullptr;
+    if ((channel == 0 || channel > MAX_CHANNEL) && channel != kVIA_WildcardChannel)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    if (id != CAN_WILDCARD_ID && (id & CAN_EXTENDED_ID_FLAG) == 0 && id >= STANDARD_IDS)
+    {
+        return kVIA_ParameterInvalid;
+    }
+
+    size_t slot = channel == kVIA_WildcardChannel ? WILDCARD_SLOT : channel;
+    int32_t* head = findHead(slot, id, true);
+    int32_t index = static_cast<int32_t>(m_requests.size());
+    Request request = { sink, id, static_cast<uint16_t>(slot), true, NO_REQUEST, *head };
+    m_requests.push_back(request);
+    if (*head != NO_REQUEST)
+    {
+        m_requests[*head].prev = index;
+    }
+    *head = index;
+    m_liveRequests++;
+    *handle = toHandle(index);
+    return kVIA_OK;
+}
+
+VIAResult MockCanBus::ReleaseRequest(VIARequestHandle handle)
+{
+    size_t index = fromHandle(handle);
+    if (handle == nullptr || index >= m_requests.size() || !m_requests[index].live)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    Request& request = m_requests[index];
+    if (request.prev != NO_REQUEST)
+    {
+        m_requests[request.prev].next = request.next;
+    }
+    else
+    {
+        *findHead(request.slot, request.id, false) = request.next;
+    }
+    if (request.next != NO_REQUEST)
+    {
+        m_requests[request.next].prev = request.prev;
+    }
+    request.live = false;
+    m_liveRequests--;
+    return kVIA_OK;
+}
+
+void MockCanBus::Reset()
+{
+    m_requests.clear();
+    ChannelTable empty;
+    empty.anyId = NO_REQUEST;
+    empty.used = false;
+    m_channels.assign(MAX_CHANNEL + 1, empty);
+    ExtendedSlot free = { EMPTY_KEY, NO_REQUEST };
+    m_extended.assign(64, free);
+    m_extendedUsed = 0;
+    m_liveRequests = 0;
+    m_online = true;
+}
+
+uint64_t MockCanBus::extendedKey(size_t slot, uint32_t id)
+{
+    return (static_cast<uint64_t>(slot) << 32) | (id & ~CAN_EXTENDED_ID_FLAG);
+}
+
+// List head of (slot, id). create sets up the table entry when missing;
+// without it a missing entry returns null.
+int32_t* MockCanBus::findHead(size_t slot, uint32_t id, bool create)
+{
+    ChannelTable& table = m_channels[slot];
+    if (create)
+    {
+        table.used = true;
+    }
+    if (id == CAN_WILDCARD_ID)
+    {
+        return &table.anyId;
+    }
+    if (id & CAN_EXTENDED_ID_FLAG)
+    {
+        return findExtended(extendedKey(slot, id), create);
+    }
+    if (table.standard.empty())
+    {
+        if (!create)
+        {
+            return nullptr;
+        }
+        table.standard.assign(STANDARD_IDS, NO_REQUEST);
+    }
+    return &table.standard[id];
+}
+
+// Entries stay once created, a list that runs empty just keeps NO_REQUEST.
+int32_t* MockCanBus::findExtended(uint64_t key, bool create)
+{
+    size_t mask = m_extended.size() - 1;
+    size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    for (;; i = (i + 1) & mask)
+    {
+        ExtendedSlot& slot = m_extended[i];
+        if (slot.key == key)
+        {
+            return &slot.head;
+        }
+        if (slot.key == EMPTY_KEY)
+        {
+            break;
+        }
+    }
+    if (!create)
+    {
+        return nullptr;
+    }
+    if ((m_extendedUsed + 1) * 2 > m_extended.size())
+    {
+        growExtended();
+        return findExtended(key, true);
+    }
+    m_extended[i].key = key;
+    m_extended[i].head = NO_REQUEST;
+    m_extendedUsed++;
+    return &m_extended[i].head;
+}
+
+void MockCanBus::growExtended()
+{
+    std::vector<ExtendedSlot> old;
+    old.swap(m_extended);
+    ExtendedSlot free = { EMPTY_KEY, NO_REQUEST };
+    m_extended.assign(old.size() * 2, free);
+    size_t mask = m_extended.size() - 1;
+    for (size_t j = 0; j < old.size(); ++j)
+    {
+        if (old[j].key == EMPTY_KEY)
+        {
+            continue;
+        }
+        size_t i = static_cast<size_t>((old[j].key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (m_extended[i].key != EMPTY_KEY)
+        {
+            i = (i + 1) & mask;
+        }
+        m_extended[i] = old[j];
+    }
+}
+
+// A sink may release requests or create new ones while it runs. Released
+// requests keep their next link and are skipped, new ones are put in front
+// of the list and wait for the next frame.
+void MockCanBus::deliver(int32_t head, const CanFrame* frame)
+{
+    for (int32_t index = head; index != NO_REQUEST; index = m_requests[index].next)
+    {
+        if (m_requests[index].live)
+        {
+            m_requests[index].sink->OnMessage(frame);
+            m_deliveries++;
+        }
+    }
+}
+
+void MockCanBus::dispatchSlot(size_t slot, const CanFrame* frame)
+{
+    const ChannelTable& table = m_channels[slot];
+    if (!table.used)
+    {
+        return;
+    }
+    int32_t head = NO_REQUEST;
+    if (frame->id & CAN_EXTENDED_ID_FLAG)
+    {
+        int32_t* found = findExtended(extendedKey(slot, frame->id), false);
+        head = found != nullptr ? *found : NO_REQUEST;
+    }
+    else if (!table.standard.empty())
+    {
+        head = table.standard[frame->id & (STANDARD_IDS - 1)];
+    }
+    deliver(head, frame);
+    deliver(table.anyId, frame);
+}
+
+void MockCanBus::Dispatch(const CanFrame* frames, size_t count)
+{
+    if (m_liveRequests == 0 || !m_online)
+    {
+        return;
+    }
+    const CanFrame* frame = frames;
+    for (size_t i = 0; i < count; ++i, frame = CanFrameNext(frame))
+    {
+        if (frame->channel != WILDCARD_SLOT)
+        {
+            dispatchSlot(frame->channel, frame);
+        }
+        dispatchSlot(WILDCARD_SLOT, frame);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MockCanBusApi.h"
+
+// Per-channel CAN message requests of one CAPL instance.
+//
+// Requests are kept in one slab and chained into a list per (channel, ID).
+// The list heads of 11 bit IDs are a direct-indexed table of 2048 entries
+// per channel, created when the channel gets its first standard request;
+// 29 bit IDs go through one open-addressing hash keyed by channel and ID.
+// Every channel also has a list for CAN_WILDCARD_ID, and requests on
+// kVIA_WildcardChannel live in a channel table of their own. A frame thus
+// finds its sinks with at most two lookups per table, without scanning.
+//
+// Released requests are unlinked in O(1) but their slots are not reused,
+// so a stale or repeated ReleaseRequest is always recognised.
+class MockCanBus : public CanBusInterface
+{
+public:
+    static const VIAChannel MAX_CHANNEL = 255;
+
+    MockCanBus();
+
+    VIASTDDECL GetVersion(uint32* busInterfaceType, int32* majorversion, int32* minorversion) override;
+    VIASTDDECL GetNumberOfChannels(VIAChannel* maxChannelNumber) override;
+    VIASTDDECL SetLine(VIAChannel channel, uint32 mode, uint32 part32) override;
+    VIASTDDECL ReleaseRequest(VIARequestHandle handle) override;
+    VIASTDDECL CreateMessageRequest(VIARequestHandle* handle, CanMessageSink* sink, VIAChannel channel, uint32 id) override;
+
+    // Drops every request, e.g. when the library that created them is gone.
+    void Reset();
+    // Hands count packed frames to the sinks of their channel and ID.
+    void Dispatch(const CanFrame* frames, size_t count);
+
+    size_t RequestCount() const { return m_liveRequests; }
+    uint64_t Deliveries() const { return m_deliveries; }
+
+private:
+    MockCanBus(const MockCanBus&);
+    MockCanBus& operator=(const MockCanBus&);
+
+    static const int32_t NO_REQUEST = -1;
+    static const uint32_t STANDARD_IDS = 2048;
+    static const size_t WILDCARD_SLOT = 0;     // channel n uses slot n, frames of channel 0 only reach wildcard requests
+
+    struct Request
+    {
+        CanMessageSink* sink;
+        uint32_t id;
+        uint16_t slot;
+        bool live;
+        int32_t prev;
+        int32_t next;               // kept when released, see deliver()
+    };
+
+    struct ChannelTable
+    {
+        std::vector<int32_t> standard;      // heads by 11 bit ID, empty until used
+        int32_t anyId;                      // CAN_WILDCARD_ID requests
+        bool used;
+    };
+
+    struct ExtendedSlot
+    {
+        uint64_t key;               // slot << 32 | 29 bit ID
+        int32_t head;
+    };
+
+    static uint64_t extendedKey(size_t slot, uint32_t id);
+    int32_t* findHead(size_t slot, uint32_t id, bool create);
+    int32_t* findExtended(uint64_t key, bool create);
+    void growExtended();
+    void dispatchSlot(size_t slot, const CanFrame* frame);
+    void deliver(int32_t head, const CanFrame* frame);
+
+    std::vector<Request> m_requests;
+    std::vector<ChannelTable> m_channels;
+    std::vector<ExtendedSlot> m_extended;
+    size_t m_extendedUsed;
+    size_t m_liveRequests;
+    bool m_online;
+    uint64_t m_deliveries;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "VIA.h"
+#include "MockMessages.h"
+
+// CAN view of the VIABus that VIAService::GetBusInterface(kVIA_CAN) hands
+// out. Vector's VIA_CAN.h is not part of this tree, so DLLs built against
+// the harness include this header instead; frames arrive in the packed
+// CanFrame layout the injection entry points use.
+
+const int32 CAN_BUS_MAJOR_VERSION = 1;
+const int32 CAN_BUS_MINOR_VERSION = 0;
+
+// CreateMessageRequest id matching every frame of the channel
+const uint32 CAN_WILDCARD_ID = 0xFFFFFFFFu;
+
+// Callback of a message request
+class CanMessageSink
+{
+public:
+    // frame and its payload are only valid during the call
+    VIASTDDECL OnMessage(const CanFrame* frame) = 0;
+};
+
+class CanBusInterface : public VIABus
+{
+public:
+    // Calls sink for every frame with id on channel. id is an 11 bit ID, a
+    // 29 bit ID with CAN_EXTENDED_ID_FLAG, or CAN_WILDCARD_ID; channel may
+    // be kVIA_WildcardChannel. The request lasts until ReleaseRequest().
+    VIASTDDECL CreateMessageRequest(VIARequestHandle* handle, CanMessageSink* sink, VIAChannel channel, uint32 id) = 0;
+};
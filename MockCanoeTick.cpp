@@ -3,8 +3,11 @@
 #include <memory>
 #include <chrono>
 #include <atomic>
+#include <algorithm>
 #include "FMI2Interface/FMUIPC.h"
 #include "FMI2Interface/IPCFactory.h"
+#include "MockTickStats.h"
+#include "AsyncLogger.h"
 
 std::atomic<bool> runloop {true};
 std::unique_ptr<IBaseIPC> m_SILConIPCObject; 
@@ -16,6 +19,10 @@ extern bool something;
 extern void setReset();
 
 int totalTicks  = 0;
+int tickWindowDepth = 1; // steps in flight, 1 keeps the lock-step protocol
+IPC_TYPE tickIpcType = IPC;
+std::string tickIpcEndpoint = "8000"; // TCP port, shared memory name or Unix socket path (FMUUnix::DEFAULT_SOCKET_PATH unless given)
+int tickIpcTimeoutMs = -1; // deadline per IPC call, -1 waits forever
 #define  PACKET_SERVER_READY 1001
 
 typedef enum
@@ -30,10 +37,23 @@ typedef enum
 
 bool init_SocketConn_FmuTick()
 {
+    if (tickWindowDepth < 1)
+    {
+        tickWindowDepth = 1;
+    }
+    else if (tickWindowDepth > IPC_MAX_STEP_WINDOW)
+    {
+        tickWindowDepth = IPC_MAX_STEP_WINDOW;
+    }
+
     bool error;
-    error = (m_SILConIPCObject = IPCFactory::createIPCObject(IPC_TYPE::IPC)) != nullptr ? true : false;
+    error = (m_SILConIPCObject = IPCFactory::createIPCObject(tickIpcType)) != nullptr ? true : false;
  
-    if (error && m_SILConIPCObject->InitCommunication("8000", "127.0.0.1") == IPC_RETURN_SUCCESS)
+    if (error)
+    {
+        m_SILConIPCObject->SetTimeout(tickIpcTimeoutMs);
+    }
+    if (error && m_SILConIPCObject->InitCommunication(tickIpcEndpoint, "127.0.0.1") == IPC_RETURN_SUCCESS)
     {
         if (IPC_RETURN_SUCCESS == m_SILConIPCObject->OpenCommunication())
         {
@@ -43,14 +63,271 @@ bool init_SocketConn_FmuTick()
     return false;
 }
 
+// States of the reconnect sequence run after IPC_ACK_RESET.
+enum ResetState
+{
+    RESET_ACKNOWLEDGE,  // answer the reset signal
+    RESET_DRAIN,        // close our side and wait for the server to close
+    RESET_CONNECT,      // open a new connection to the restarted server
+    RESET_AWAIT_READY,  // wait for PACKET_SERVER_READY
+    RESET_BACKOFF,      // pause before the next connection attempt
+    RESET_DONE
+};
+
+// First and longest pause between two reconnect attempts.
+constexpr int RESET_INITIAL_BACKOFF_US = 100;
+constexpr int RESET_MAX_BACKOFF_US = 50 * 1000;
+
+bool inBandReset = false; // keep the connection open across a reset
+
+// Reset-to-ready latency of all resets seen so far.
+static int resetCount = 0;
+static std::chrono::nanoseconds resetLatencyMin = std::chrono::nanoseconds::max();
+static std::chrono::nanoseconds resetLatencyMax = std::chrono::nanoseconds::zero();
+static std::chrono::nanoseconds resetLatencyTotal = std::chrono::nanoseconds::zero();
+
+static void recordResetLatency(std::chrono::nanoseconds latency)
+{
+    resetCount++;
+    resetLatencyMin = std::min(resetLatencyMin, latency);
+    resetLatencyMax = std::max(resetLatencyMax, latency);
+    resetLatencyTotal += latency;
+    LOG_INFO(LOG_CAT_TICK, "[fmi2DoStep] Reset to ready took %lld us",
+             (long long)std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+void printResetStatistics()
+{
+    if (resetCount == 0)
+    {
+        return;
+    }
+    std::cout << "Resets: " << resetCount
+              << " reset-to-ready min/avg/max [us]: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(resetLatencyMin).count() << "/"
+              << std::chrono::duration_cast<std::chrono::microseconds>(resetLatencyTotal / resetCount).count() << "/"
+              << std::chrono::duration_cast<std::chrono::microseconds>(resetLatencyMax).count() << std::endl;
+}
+
+// Reconnects after the SIL controller signalled IPC_ACK_RESET and blocks
+// until the restarted server reports PACKET_SERVER_READY.
+static void handleServerReset()
+{
+    LOG_INFO(LOG_CAT_TICK, "Received: Reset signal from silcontroller");
+
+    auto resetStart = std::chrono::steady_clock::now();
+    int backoffUs = RESET_INITIAL_BACKOFF_US;
+    bool keepConnection = inBandReset;
+    ResetState state = RESET_ACKNOWLEDGE;
+
+    while (state != RESET_DONE)
+    {
+        switch (state)
+        {
+        case RESET_ACKNOWLEDGE:
+        {
+            // In-band: ask the controller to keep the socket and only send
+            // PACKET_SERVER_READY once it has restarted.
+            uint64_t send_value = keepConnection ? (uint64_t)IPC_RESET_KEEP_CONNECTION : (uint64_t)IPC_ACK_OK;
+            m_SILConIPCObject->WriteData(&send_value, sizeof(uint64_t));
+            state = keepConnection ? RESET_AWAIT_READY : RESET_DRAIN;
+            break;
+        }
+        case RESET_DRAIN:
+            m_SILConIPCObject->CloseCommunication();
+            m_SILConIPCObject->waitForServerToClose();
+            state = RESET_CONNECT;
+            break;
+        case RESET_CONNECT:
+            state = (IPC_RETURN_SUCCESS == m_SILConIPCObject->OpenCommunication()) ? RESET_AWAIT_READY : RESET_BACKOFF;
+            break;
+        case RESET_AWAIT_READY:
+        {
+            // Wait for server to send PACKET_SERVER_READY (e.g., int value)
+            int ready = 0;
+            int rc = m_SILConIPCObject->ReadStatus(&ready);
+            if (rc == IPC_RETURN_SUCCESS && ready == PACKET_SERVER_READY)
+            {
+                LOG_INFO(LOG_CAT_TICK, "[fmi2DoStep] Server is ready");
+                state = RESET_DONE;
+            }
+            else if (keepConnection)
+            {
+                // Controller does not support the in-band handshake
+                LOG_WARN(LOG_CAT_TICK, "[fmi2DoStep] In-band reset failed, reconnecting...");
+                keepConnection = false;
+                state = RESET_DRAIN;
+            }
+            else
+            {
+                LOG_WARN(LOG_CAT_TICK, "[fmi2DoStep] Server not ready yet, retrying...");
+                m_SILConIPCObject->CloseCommunication(); 
+                state = RESET_BACKOFF;
+            }
+            break;
+        }
+        case RESET_BACKOFF:
+            std::this_thread::sleep_for(std::chrono::microseconds(backoffUs));
+            backoffUs = std::min(backoffUs * 2, RESET_MAX_BACKOFF_US);
+            state = RESET_CONNECT;
+            break;
+        case RESET_DONE:
+            break;
+        }
+    }
+
+    recordResetLatency(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - resetStart));
+}
+
+// Book-keeping for every step the SIL controller has acknowledged.
+static void completeTick()
+{
+    if (totalTicks == 1000)
+    {
+        setReset();
+    }
+    
+    LOG_DEBUG(LOG_CAT_TICK, "total ticks: %d", totalTicks);
+    
+    totalTicks = totalTicks + 1;
+}
+
+// Step frames sent but not yet acknowledged, kept as a ring of
+// tickWindowDepth entries.
+struct InFlightStep
+{
+    uint32_t sequence;
+    uint32_t stepCount;
+};
+static InFlightStep inFlightSteps[IPC_MAX_STEP_WINDOW];
+static int inFlightHead = 0;
+static int inFlightCount = 0;
+static uint32_t nextStepSequence = 0;
+
+// Reads one IPCStepAck and matches it against the oldest outstanding frame.
+static bool collectStepAck()
+{
+    IPCStepAck ack;
+    int readSize = 0;
+    int64_t waitStart = LatencyHistogram::Now();
+    IPC_RETURN_TYPE rc = m_SILConIPCObject->ReadData(&ack, sizeof(ack), &readSize);
+    recordTickPhase(TICK_PHASE_ACK_WAIT, waitStart);
+    if (IPC_RETURN_SUCCESS != rc || readSize != sizeof(ack))
+    {
+        LOG_ERROR(LOG_CAT_TICK, "[fmi2DoStep] Failed to read step ack: %s", m_SILConIPCObject->getErrorDescription().c_str());
+        return false;
+    }
+
+    InFlightStep expected = inFlightSteps[inFlightHead];
+    if (ack.sequence != expected.sequence)
+    {
+        LOG_ERROR(LOG_CAT_TICK, "[fmi2DoStep] Step ack out of sequence, expected %u got %u",
+                  expected.sequence, ack.sequence);
+        return false;
+    }
+    inFlightHead = (inFlightHead + 1) % IPC_MAX_STEP_WINDOW;
+    inFlightCount--;
+
+    // Steps in front of stepIndex were executed whatever the status says.
+    uint32_t stepsDone = ack.stepIndex < expected.stepCount ? ack.stepIndex : expected.stepCount;
+    if (IPC_ACK_OK == ack.status)
+    {
+        stepsDone = expected.stepCount;
+    }
+    for (uint32_t i = 0; i < stepsDone; ++i)
+    {
+        completeTick();
+    }
+
+    if (IPC_ACK_OK == ack.status)
+    {
+        return true;
+    }
+    else if (IPC_ACK_RESET == ack.status)
+    {
+        // The controller drops every step queued behind the reset, so do we,
+        // and the restarted controller numbers frames from 0 again.
+        inFlightHead = 0;
+        inFlightCount = 0;
+        nextStepSequence = 0;
+        handleServerReset();
+        completeTick();
+        return true;
+    }
+
+    LOG_ERROR(LOG_CAT_TICK, "[fmi2DoStep] Step %u of frame %u failed with status %d",
+              ack.stepIndex, ack.sequence, ack.status);
+    return false;
+}
+
+// Sends one sequenced frame advancing stepCount steps and only blocks for acks
+// once tickWindowDepth frames are outstanding, so CAPL work overlaps with the
+// controller's step.
+static bool executeSequencedStep(int count, uint32_t stepCount)
+{
+    IPCStepFrame frame;
+    frame.command = stepCount > 1 ? IPC_CMD_STEP_BATCH : IPC_CMD_STEP;
+    frame.sequence = nextStepSequence++;
+    frame.stepSize = (uint64_t)count;
+    frame.stepCount = stepCount;
+
+    int64_t writeStart = LatencyHistogram::Now();
+    IPC_RETURN_TYPE rc = m_SILConIPCObject->WriteData(&frame, sizeof(frame));
+    recordTickPhase(TICK_PHASE_WRITE, writeStart);
+    if (IPC_RETURN_SUCCESS != rc)
+    {
+        return false;
+    }
+    InFlightStep& slot = inFlightSteps[(inFlightHead + inFlightCount) % IPC_MAX_STEP_WINDOW];
+    slot.sequence = frame.sequence;
+    slot.stepCount = stepCount;
+    inFlightCount++;
+
+    while (inFlightCount >= tickWindowDepth)
+    {
+        if (!collectStepAck())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Waits for the acks of all outstanding steps of the windowed mode.
+bool drainStepWindow()
+{
+    while (inFlightCount > 0)
+    {
+        if (!collectStepAck())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool executeStep(int count)
 {
+    if (tickWindowDepth > 1)
+    {
+        return executeSequencedStep(count, 1);
+    }
+
     fmi2Status status = fmi2Error;
     uint64_t stepsize = (uint64_t)count;
     
+    int64_t phaseStart = LatencyHistogram::Now();
     m_SILConIPCObject->WriteData(&stepsize, sizeof(uint64_t));
+    recordTickPhase(TICK_PHASE_WRITE, phaseStart);
     int recv_value = 0;
-    m_SILConIPCObject->ReadStatus(&recv_value);
+    phaseStart = LatencyHistogram::Now();
+    IPC_RETURN_TYPE rc = m_SILConIPCObject->ReadStatus(&recv_value);
+    recordTickPhase(TICK_PHASE_ACK_WAIT, phaseStart);
+    if (IPC_RETURN_TIMEOUT == rc)
+    {
+        LOG_ERROR(LOG_CAT_TICK, "[fmi2DoStep] SIL controller stalled: %s", m_SILConIPCObject->getErrorDescription().c_str());
+        return false;
+    }
     
     if (IPC_ACK_OK == recv_value)
     {
@@ -58,39 +335,7 @@ bool executeStep(int count)
     }
     else if(IPC_ACK_RESET == recv_value)
     {
-        std::cout << "Received: Reset signal from silcontroller" << std::endl;
-        
-        int send_value = IPC_ACK_OK;
-        m_SILConIPCObject->WriteData(&send_value, sizeof(uint64_t));
-
-        m_SILConIPCObject->CloseCommunication();
-        m_SILConIPCObject->waitForServerToClose(); 
-
-        // Reconnect + wait for ready packet
-        IPC_RETURN_TYPE connected = IPC_RETURN_ERROR;
-        
-        while (true)
-        {
-            connected = m_SILConIPCObject->OpenCommunication();
-            if (connected == IPC_RETURN_SUCCESS)
-            {
-                // Wait for server to send PACKET_SERVER_READY (e.g., int value)
-                int ready = 0;
-                int rc = m_SILConIPCObject->ReadStatus(&ready);
-                if (rc == IPC_RETURN_SUCCESS && ready == PACKET_SERVER_READY)
-                {
-                    std::cout << "[fmi2DoStep] Server is ready\n";
-                    break;
-                }
-                else
-                {
-                    std::cerr << "[fmi2DoStep] Server not ready yet, retrying...\n";
-                    m_SILConIPCObject->CloseCommunication(); 
-                }
-            }
-
-            sleep(2); 
-        }
+        handleServerReset();
         
         status = fmi2OK;
         recv_value = IPC_ACK_OK;
@@ -101,14 +346,7 @@ bool executeStep(int count)
         return false;
     }
     
-    if (totalTicks == 1000)
-    {
-        setReset();
-    }
-    
-    std::cout << "total ticks: " << totalTicks << std::endl;
-    
-    totalTicks = totalTicks + 1;
+    completeTick();
    
     return true;
     
@@ -120,8 +358,20 @@ bool doStep(std::chrono::microseconds cycle_time)
     return (executeStep(static_cast<int>(count)));
 }
 
-void fmi2DoStep(double communicationStepSize)
+bool fmi2DoStep(double communicationStepSize)
 {
     int valueMicroSec = int(communicationStepSize * 1000 * 1000);
-    doStep(std::chrono::microseconds(valueMicroSec));
+    return doStep(std::chrono::microseconds(valueMicroSec));
+}
+
+// Advances stepCount steps of communicationStepSize with a single batch frame
+// and one aggregated ack.
+bool fmi2DoSteps(double communicationStepSize, int stepCount)
+{
+    if (stepCount <= 1)
+    {
+        return fmi2DoStep(communicationStepSize);
+    }
+    int valueMicroSec = int(communicationStepSize * 1000 * 1000);
+    return executeSequencedStep(valueMicroSec, static_cast<uint32_t>(stepCount));
 }
@@ -0,0 +1,65 @@
+#include "MockCaplNode.h"
+#include <string.h>
+#include "MockCaplSystem.h"
+
+MockCaplNode::MockCaplNode()
+    : m_capl(nullptr)
+{
+}
+
+void MockCaplNode::Attach(MockCapl* capl, const std::string& name)
+{
+    m_capl = capl;
+    m_name = name;
+}
+
+VIAResult MockCaplNode::GetName(char* buffer, int32 bufferLength)
+{
+    if (buffer == nullptr || bufferLength <= static_cast<int32>(m_name.size()))
+    {
+        return kVIA_BufferToSmall;
+    }
+    memcpy(buffer, m_name.c_str(), m_name.size() + 1);
+    return kVIA_OK;
+}
+
+VIAResult MockCaplNode::GetCaplFunction(VIACaplFunction** caplfct, const char* functionName)
+{
+    if (m_capl == nullptr)
+    {
+        return kVIA_ServiceNotRunning;
+    }
+    return m_capl->GetCaplFunction(caplfct, functionName);
+}
+
+VIAResult MockCaplNode::ReleaseCaplFunction(VIACaplFunction* caplfct)
+{
+    if (m_capl == nullptr)
+    {
+        return kVIA_ServiceNotRunning;
+    }
+    return m_capl->ReleaseCaplFunction(caplfct);
+}
+
+VIAResult MockCaplNode::GetBusName(char* pName, uint32 size)
+{
+    if (pName == nullptr || size < 4)
+    {
+        return kVIA_BufferToSmall;
+    }
+    memcpy(pName, "CAN", 4);
+    return kVIA_OK;
+}
+
+VIAResult MockCaplNode::GetBusType(uint32* interfaceType)
+{
+    *interfaceType = kVIA_CAN;
+    return kVIA_OK;
+}
+
+// The node sees every channel of the bus
+VIAResult MockCaplNode::GetChannel(VIAChannel* pChannel)
+{
+    *pChannel = kVIA_WildcardChannel;
+    return kVIA_OK;
+}
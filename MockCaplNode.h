@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include "VIA.h"
+
+class MockCapl;
+
+// The network node of a CAPL instance, returned by
+// VIAService::GetCurrentNode. It sits on the CAN bus and hands out the
+// CAPL callbacks of its MockCapl; database access is not mocked.
+class MockCaplNode : public VIANode {
+public:
+    MockCaplNode();
+
+    void Attach(MockCapl* capl, const std::string& name);
+
+    VIASTDDECL GetName(char* buffer, int32 bufferLength) override;
+    VIASTDDECL GetCaplFunction(VIACaplFunction** caplfct, const char* functionName) override;
+    VIASTDDECL ReleaseCaplFunction(VIACaplFunction* caplfct) override;
+    VIASTDDECL GetBusName(char* pName, uint32 size) override;
+    VIASTDDECL GetBusType(uint32* interfaceType) override;
+    VIASTDDECL GetChannel(VIAChannel* pChannel) override;
+    VIASTDDECL GetDBAttributeType(uint32* pType, uint32 objectType, const char* objectName, const char* pAttrName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBAttributeValue(double* pValue, uint32 objectType, const char* objectName, const char* pAttrName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBAttributeString(char* pBuffer, int32 bufferLength, uint32 objectType, const char* objectName, const char* pAttrName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetECU(VIAECU** pECU) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDatabaseName(char* pBuffer, int32 bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDatabasePath(char* pBuffer, int32 bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetMessage(uint32 ID, VIDBMessageDefinition** message) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetMessage(const char* name, VIDBMessageDefinition** message) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetMessageDefinitionIterator(VIDBMessageDefinitionIterator** iterator) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetAttribute(const char* pAttrName, VIDBAttribute** attribute) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetAttributeType(uint32* pType, const char* pAttrName) const override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetAttributeValue(double* pValue, const char* pAttrName) const override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetAttributeString(char* pBuffer, int32 bufferLength, const char* pAttrName) const override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetAttributeIterator(VIDBAttributeIterator** iterator) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBNode(VIDBNodeDefinition** nodeDefinition) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL OpenNodePanel(uint32 open) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSecurityManagerProfileInstance(char* buffer, uint32& bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSecurityManagerProfileInstanceLength(uint32& bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL DeferStop(uint32 maxDeferTime) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL CompleteStop() override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ProcessOEMBackendRequest(VIAOEMBackendRequestHandlerType requestHandlerType, const char* requestHandlerId, uint32 requestHandlerIdLength, const char* requestHandlerParameter, uint32 requestHandlerParameterLength, const uint8* requestData, uint32 requestDataLength, VIAOnOEMBackendResponse* sink) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetNodeType(uint32* nodeType) const override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetStackSecurityProfile(char* buffer, uint32& bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetStackSecurityProfileLength(uint32& bufferLength) override { return kVIA_FunctionNotImplemented; }
+
+private:
+    MockCapl* m_capl;
+    std::string m_name;
+};
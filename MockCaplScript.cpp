@@ -1,15 +1,20 @@
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <chrono>
-#include <dlfcn.h>
-#include "MockCaplSystem.h"
+#include <vector>
+#include <memory>
+#include "CaplInstance.h"
+#include "CaplWorkerPool.h"
+#include "MockTickStats.h"
 #include "MockMessages.h"
+#include "AsyncLogger.h"
 
 extern bool blockSendingTick;
 extern bool blockSendingData;
+extern double communicationStepSize;
 
 bool reset = false;
-bool capldll_initialization = false;
 
 constexpr int SIM_NORESET = 0;
 constexpr int master = 1;
@@ -19,94 +24,174 @@ int port = 2019;
 double stepsize = 5.0;
 int sim_reset = SIM_NORESET;
 int gHandle = 0;
-void *glibHandle = nullptr;
-
-MockCapl mockCapl;
-
-typedef void (*RegisterCDLLFunc)(VIACapl *);
-typedef void (*InitializeFunc)(uint32 handle, char *ipaddress, uint32 port, uint32 ismaster);
-typedef void (*SetParamFunc)(uint32 handle, uint32 parameter);
-typedef void (*transactionofTxRxDataFunc)(uint32 handle);
-typedef void (*SetCanFrameFunc)( uint32 handle,unsigned long channel, unsigned long direction,unsigned long canid,
-                                long long timestamp,unsigned long type, unsigned long dlc, unsigned long rtr,
-                                unsigned long fdf, unsigned long brs, unsigned long esi, unsigned char payload[]);
-                                
-                                
+std::string caplDllPath = "/home/mgl1kor/git_repositories/pjvecu/onesilcontroller/mockCanoeSW/libs/libcaplserver.so";
+
+// CAPL DLL copies hosted by this process, set by --instances. Several
+// instances are loaded into namespaces of their own and stepped by
+// caplWorkerCount threads, 0 picks one per core.
+int caplInstanceCount = 1;
+int caplWorkerCount = 0;
+static std::vector<std::unique_ptr<CaplInstance> > caplInstances;
+static CaplWorkerPool caplWorkers;
+
+// Trace replayed instead of the generated frames, set by --replay
+std::string replayTracePath;
+
+// Ethernet frames injected from a pcap, set by --eth-replay
+std::string ethReplayPath;
+static const uint32_t ETH_REPLAY_CHANNEL = 1;
+
+// FlexRay cluster schedule injected every tick, set by --flexray
+std::string flexraySchedulePath;
+
+// Frames transmitted by the CAPL DLL, written to --capture
+std::string capturePath;
+
+// Periodic frames sent when no trace is replayed, configured by --busload
+std::string busLoadConfigPath;
+
+// CAN bus connecting the instances, enabled by --virtual-can
+bool virtualCanEnabled = false;
+static VirtualCanBus virtualCanBus;
+
+// One CAPL tick per communication step, also when steps are sent in batches.
+static int64_t tickPeriodNs()
+{
+    return static_cast<int64_t>(communicationStepSize * 1e9);
+}
+
 void setParameter()
 {
-    SetParamFunc setParamCAPLDLL = (SetParamFunc)dlsym(glibHandle, "_Z8SetParamjj");
-    setParamCAPLDLL(0xBEEF, sim_reset); 
+    for (size_t i = 0; i < caplInstances.size(); ++i)
+    {
+        caplInstances[i]->SetParameter(sim_reset);
+    }
 }
 
-void onPreStart()
+bool onPreStart()
 {
-    glibHandle = dlopen("/home/mgl1kor/git_repositories/pjvecu/onesilcontroller/mockCanoeSW/libs/libcaplserver.so", RTLD_LAZY);
-    
-    if (!glibHandle)
+    if (caplInstanceCount < 1)
     {
-        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        caplInstanceCount = 1;
     }
-    
-    RegisterCDLLFunc registerCAPLDLL = (RegisterCDLLFunc)dlsym(glibHandle, "VIARegisterCDLL");
-    if (!registerCAPLDLL)
+
+    CaplInstanceConfig config;
+    config.dllPath = caplDllPath;
+    config.isolated = caplInstanceCount > 1;
+    config.ipAddress = ipaddress;
+    config.basePort = port;
+    config.master = master;
+    config.replayTracePath = replayTracePath;
+    config.busLoadConfigPath = busLoadConfigPath;
+    config.ethReplayPath = ethReplayPath;
+    config.ethReplayChannel = ETH_REPLAY_CHANNEL;
+    config.flexraySchedulePath = flexraySchedulePath;
+    config.capturePath = capturePath;
+    config.instanceCount = caplInstanceCount;
+    config.tickPeriodNs = tickPeriodNs();
+    config.virtualCanBus = virtualCanEnabled ? &virtualCanBus : nullptr;
+    virtualCanBus.Start(config.tickPeriodNs);
+
+    LOG_INFO(LOG_CAT_CAPL, "--------------------- CAPL-DLL Registration -----------------------");
+    LOG_INFO(LOG_CAT_CAPL, "Start procedure:");
+
+    std::vector<CaplInstance*> instances;
+    for (int i = 0; i < caplInstanceCount; ++i)
     {
-        std::cerr << "Failed to find VIARegisterCDLL in DLL." << std::endl;
+        caplInstances.push_back(std::unique_ptr<CaplInstance>(new CaplInstance(i)));
+        if (!caplInstances.back()->Open(config))
+        {
+            LOG_ERROR(LOG_CAT_CAPL, "Instance %d: %s", i, caplInstances.back()->getErrorDescription().c_str());
+            return false;
+        }
+        instances.push_back(caplInstances.back().get());
     }
-    
-    std::cout << "--------------------- CAPL-DLL Registration -----------------------" << std::endl;
-    std::cout << "Start procedure:" << std::endl;
-    
-    registerCAPLDLL(&mockCapl);
-}
 
-void onstart()
-{    
-    if(capldll_initialization != true)
+    if (caplInstanceCount > 1)
     {
-        InitializeFunc initCAPLDLL = (InitializeFunc)dlsym(glibHandle, "_Z7appInitjPcjj");
-        initCAPLDLL(0xBEEF, ipaddress, port, master); 
-        std::cout << "Capl DLL Initialization: Done!" << std::endl;
-        setParameter();   
-        capldll_initialization = true; 
+        int workers = caplWorkerCount > 0 ? caplWorkerCount : static_cast<int>(std::thread::hardware_concurrency());
+        caplWorkers.Start(instances, workers > 0 ? workers : 1);
+        LOG_INFO(LOG_CAT_CAPL, "%d CAPL instances on %d worker threads", caplInstanceCount, caplWorkers.WorkerCount());
     }
+    return true;
 }
 
-void onAnyCanMessage(CanMessage& msg)
+// Swaps in rebuilt CAPL DLLs between two ticks. Each DLL is registered and
+// initialised again by the next runCaplTick().
+bool reloadCaplDll()
 {
-    SetCanFrameFunc setCanFrame = (SetCanFrameFunc)dlsym(glibHandle,"_Z11setCanFramejmmmxmmmmmmPh");   
-    setCanFrame(0xBEEF, msg.channel, msg.direction, msg.id, msg.timestamp_ns, msg.type, msg.dlc, msg.rtr, msg.fdf, msg.brs, msg.esi, msg.data);
+    for (size_t i = 0; i < caplInstances.size(); ++i)
+    {
+        if (!caplInstances[i]->Reload())
+        {
+            LOG_ERROR(LOG_CAT_CAPL, "Instance %d: %s", (int)i, caplInstances[i]->getErrorDescription().c_str());
+            return false;
+        }
+    }
+    return true;
 }
 
-void transactionofTxRxData()
+// Steps every CAPL instance once; with several instances the workers run
+// them in parallel and this returns when the last one is done. The frames
+// they sent on the virtual CAN bus are arbitrated for the next tick.
+void runCaplTick()
 {
-    transactionofTxRxDataFunc transactionofTxRxData = (transactionofTxRxDataFunc)dlsym(glibHandle, "_Z21transactionofTxRxDataj");
-    static int counter = 0;
-       
-    for (int i = 0; i < 1; ++i) 
+    if (caplWorkers.WorkerCount() > 0)
     {
-        CanMessage msg{};
-        msg.id = 0x100 + i;
-        msg.channel = 5;
-        msg.direction = 0;
-        msg.timestamp_ns = 1000000 * i;
-        msg.type = 1;
-        msg.dlc = 8;
-        msg.rtr = 0;
-        msg.fdf = 0;
-        msg.brs = 0;
-        msg.esi = 0;
-
-        // Example payload: fill with 0x10 + i
-        for (int j = 0; j < msg.dlc; ++j) 
+        caplWorkers.Tick();
+    }
+    else
+    {
+        for (size_t i = 0; i < caplInstances.size(); ++i)
         {
-            msg.data[j] = 0x10 + i + j;
+            caplInstances[i]->Tick();
         }
+    }
+    if (virtualCanEnabled)
+    {
+        virtualCanBus.Arbitrate();
+    }
+}
+
+// Flushes the remaining captured frames, closes the capture files and stops
+// the workers.
+void closeFrameCapture()
+{
+    caplWorkers.Stop();
+    for (size_t i = 0; i < caplInstances.size(); ++i)
+    {
+        caplInstances[i]->CloseCapture();
+    }
+}
 
-        onAnyCanMessage(msg);
+void printCanInjectionStatistics()
+{
+    for (size_t i = 0; i < caplInstances.size(); ++i)
+    {
+        caplInstances[i]->PrintStatistics(std::cout);
+    }
+    if (virtualCanEnabled)
+    {
+        std::cout << "Virtual CAN bus: " << virtualCanBus.NodeCount() << " nodes, "
+                  << virtualCanBus.FramesArbitrated() << " frames arbitrated, busiest tick "
+                  << virtualCanBus.BusiestTick() << " frames" << std::endl;
     }
+}
 
-    transactionofTxRxData(0xBEEF); 
-      
+// Appends the CAPL function histograms of every instance to the tick
+// histogram file.
+void dumpCaplFunctionHistograms(int tick, const char* reason)
+{
+    std::ofstream out(tickHistogramFile.c_str(), std::ios::app);
+    if (!out)
+    {
+        std::cerr << "Cannot write CAPL function histograms to " << tickHistogramFile << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < caplInstances.size(); ++i)
+    {
+        caplInstances[i]->WriteFunctionHistograms(out, tick, reason);
+    }
 }
 
 void setReset()
@@ -118,6 +203,6 @@ void setReset()
 
     sim_reset = 4;
     setParameter();
-    std::cout << "dyn reset triggered" << std::endl;
+    LOG_INFO(LOG_CAT_CAPL, "dyn reset triggered");
     
 }
\ No newline at end of file
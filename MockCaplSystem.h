@@ -1,95 +1,69 @@
+#pragma once
+
 #include <iostream>
 #include <unordered_map>
 #include <string>
-#include <functional>
 #include <dlfcn.h>
 #include <cstring>
 
 // Include Vector-provided headers
 #include "VIA.h"
 #include "VIA_CDLL.h"
+#include "AsyncLogger.h"
+#include "FrameCapture.h"
+#include "CaplFunctionRegistry.h"
 
 using std::string;
 using std::unordered_map;
-using std::function;
-
-// --- Mock VIACaplFunction Implementation ---
-class MockCaplFunction : public VIACaplFunction {
-public:
-    std::string name;
-    std::function<void(void*)> callback;
-    std::string paramTypes;
-    char returnType;
-
-    MockCaplFunction(const string& n, function<void(void*)> cb,
-                    const std::string& ptype)
-        : name(n), callback(cb),paramTypes(ptype) {}
-
-    VIASTDDECL ParamSize(int32* size) override {
-        *size = 0; // For simplicity
-        return kVIA_OK;
-    }
 
-    VIASTDDECL ParamCount(int32* size) override {
-        if (!size) return kVIA_DBParameterInvalid;
-        *size = static_cast<int32>(paramTypes.length());
-        return kVIA_OK;
-    }
-
-    VIASTDDECL ParamType(char* type, int32 nth) override {
-        if (!type || nth < 0 || nth >= static_cast<int32>(paramTypes.length()))
-        return kVIA_DBParameterInvalid;
-        *type = paramTypes[nth];
-        return kVIA_OK;
-    }
-
-    VIASTDDECL ResultType(char* type) override {
-        strcpy(type, "V"); // Dummy return type
-        return kVIA_OK;
-    }
-
-    VIASTDDECL Call(uint32* result, void* params) override {
-        std::cout << "Mock: Calling CAPL function " << name << std::endl;
-        if (callback) callback(params);
-        *result = 0;
-        return kVIA_OK;
-    }
-
-    VIASTDDECL CallReturnsDouble(double* result, void* params) override {
-        std::cout << "Mock: Calling CAPL function (returns double) " << name << std::endl;
-        if (callback) callback(params);
-        *result = 0.0;
-        return kVIA_OK;
-    }
-};
+// Capture of the CAPL instance currently calling into the harness
+FrameCapture& currentFrameCapture();
+
+// Transmit callbacks, the CAPL signature follows from the C++ one. The CAN
+// parameters mirror setCanFrame: channel, direction, ID, type, DLC, RTR,
+// FDF, BRS, ESI, then the payload length and the payload.
+typedef void (*WriteCanFrameFunc)(CaplDword, CaplDword, CaplDword, CaplDword, CaplDword,
+                                  CaplDword, CaplDword, CaplDword, CaplDword, CaplDword, CaplBytes);
+typedef void (*WriteEthFrameFunc)(CaplDword, CaplQword, CaplQword, CaplDword, CaplDword, CaplDword, CaplBytes);
+typedef void (*WriteFlexrayFrameFunc)(CaplDword, CaplDword, CaplDword, CaplDword, CaplDword, CaplDword,
+                                      CaplBytes, CaplDword, CaplDword);
+
+static_assert(caplTypesEqual(CaplFunctionTraits<WriteCanFrameFunc>::Types::value, CAPTURE_CAN_SIGNATURE), "CAN callback signature");
+static_assert(caplTypesEqual(CaplFunctionTraits<WriteEthFrameFunc>::Types::value, CAPTURE_ETH_SIGNATURE), "Ethernet callback signature");
+static_assert(caplTypesEqual(CaplFunctionTraits<WriteFlexrayFrameFunc>::Types::value, CAPTURE_FLEXRAY_SIGNATURE), "FlexRay callback signature");
+
+template <CaptureFrameKind Kind, typename... Args>
+void captureCallback(Args... args)
+{
+    currentFrameCapture().CaptureFrame(Kind, args...);
+}
+
+// Captures a CAN frame and sends it on the virtual CAN bus of the calling
+// instance, when it is attached to one.
+void writeCanFrameCallback(CaplDword channel, CaplDword direction, CaplDword id, CaplDword type, CaplDword dlc,
+                           CaplDword rtr, CaplDword fdf, CaplDword brs, CaplDword esi, CaplDword length, CaplBytes data);
 
 // --- Mock VIACapl Implementation ---
 class MockCapl : public VIACapl {
 public:
-    unordered_map<string, MockCaplFunction*> functionMap;
+    CaplFunctionRegistry functions;
+    uint32 caplHandle;
 
-    MockCapl() {
+    explicit MockCapl(uint32 handle = 0xBEEF)
+        : caplHandle(handle)
+    {
         // Register mock CAPL callback functions
-        registerFunction("CALLBACK_WriteEthFrame", [](void* params) 
-        {
-            std::cout << "Executing mock CALLBACK_WriteEthFrame" << std::endl;
-            // You could cast params to your struct if needed
-        },"DUUDDDB");
-
-        registerFunction("CALLBACK_WriteCanFrame", [](void* params) 
-        {
-            std::cout << "Executing mock CALLBACK_WriteCanFrame" << std::endl;
-        },"DDDDDDDDDDB");
-
-        registerFunction("CALLBACK_WriteFlexrayFrame", [](void* params) 
-        {
-            std::cout << "Executing mock CALLBACK_WriteFlexrayFrame" << std::endl;
-        },"DDDDDDBDD");
+        registerFunction<WriteEthFrameFunc, &captureCallback<CAPTURE_ETH> >("CALLBACK_WriteEthFrame");
+        registerFunction<WriteCanFrameFunc, &writeCanFrameCallback>("CALLBACK_WriteCanFrame");
+        registerFunction<WriteFlexrayFrameFunc, &captureCallback<CAPTURE_FLEXRAY> >("CALLBACK_WriteFlexrayFrame");
     }
 
-    void registerFunction(const string& name, function<void(void*)> func, std::string paramTypes) 
+    template <typename Fn, Fn F>
+    void registerFunction(const string& name) 
     {
-        functionMap[name] = new MockCaplFunction(name, func,paramTypes);
+        if (functions.Register<Fn, F>(name.c_str()) == CaplFunctionRegistry::NO_FUNCTION) {
+            LOG_ERROR(LOG_CAT_CAPL, "Mock: Function registered twice: %s", name.c_str());
+        }
     }
 
     VIASTDDECL GetVersion(int32* major, int32* minor) override 
@@ -101,25 +75,29 @@ public:
 
     VIASTDDECL GetCaplHandle(uint32* handle) override 
     {
-        *handle = 0xBEEF; // Dummy handle
+        *handle = caplHandle;
         return kVIA_OK;
     }
 
     VIASTDDECL GetCaplFunction(VIACaplFunction** caplfct, const char* functionName) override 
     {
-        auto it = functionMap.find(functionName);
-        if (it != functionMap.end()) {
-            *caplfct = it->second;
-            std::cout << "Mock: Provided function handle for " << functionName << std::endl;
+        MockCaplFunction* function = functions.Acquire(functionName);
+        if (function != nullptr) {
+            *caplfct = function;
+            LOG_DEBUG(LOG_CAT_CAPL, "Mock: Provided function handle for %s", functionName);
             return kVIA_OK;
         }
-        std::cerr << "Mock: Function not found: " << functionName << std::endl;
+        LOG_ERROR(LOG_CAT_CAPL, "Mock: Function not found: %s", functionName);
         return kVIA_FunctionNotImplemented;
     }
 
     VIASTDDECL ReleaseCaplFunction(VIACaplFunction* caplfct) override 
     {
-        std::cout << "Mock: Released function handle" << std::endl;
+        if (!functions.Release(caplfct)) {
+            LOG_ERROR(LOG_CAT_CAPL, "Mock: Released a function handle that is not acquired");
+            return kVIA_ObjectInvalid;
+        }
+        LOG_DEBUG(LOG_CAT_CAPL, "Mock: Released function handle for %s", static_cast<MockCaplFunction*>(caplfct)->name);
         return kVIA_OK;
     }
 };
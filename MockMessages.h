@@ -1,16 +1,84 @@
-#include <array>
+#pragma once
+
+#include <stddef.h>
 #include <stdint.h>
 
-struct CanMessage {
+// Set on CanFrame::id for 29-bit identifiers, like CAPL's mkExtId().
+const uint32_t CAN_EXTENDED_ID_FLAG = 0x80000000u;
+
+const uint32_t CAN_MAX_PAYLOAD = 64;
+
+// CAN / CAN FD frame as buffered by the harness: a 16 byte header followed
+// directly by `length` payload bytes. Frames of a batch lie back to back,
+// each padded to 8 bytes, so a classic frame takes 24 bytes and a full CAN FD
+// frame 80. Use CanFrameNext() to step through a batch.
+struct CanFrame {
+    int64_t timestamp_ns;
     uint32_t id;
-    unsigned long channel;
-    unsigned long direction;
+    uint8_t channel;
+    uint8_t dlc : 4;
+    uint8_t type : 4;
+    uint8_t direction : 2;      // 0 Rx, 1 Tx, 2 TxRequest
+    uint8_t rtr : 1;
+    uint8_t fdf : 1;
+    uint8_t brs : 1;
+    uint8_t esi : 1;
+    uint8_t : 2;
+    uint8_t length;             // payload bytes that follow the header
+
+    unsigned char* Data() { return reinterpret_cast<unsigned char*>(this + 1); }
+    const unsigned char* Data() const { return reinterpret_cast<const unsigned char*>(this + 1); }
+};
+
+static_assert(sizeof(CanFrame) == 16, "CanFrame header must stay 16 bytes");
+
+// Bytes taken by a frame with length payload bytes inside a batch.
+inline size_t CanFrameSize(uint32_t length)
+{
+    return (sizeof(CanFrame) + length + 7) & ~static_cast<size_t>(7);
+}
+
+inline const CanFrame* CanFrameNext(const CanFrame* frame)
+{
+    return reinterpret_cast<const CanFrame*>(reinterpret_cast<const unsigned char*>(frame) + CanFrameSize(frame->length));
+}
+
+// A single frame with room for the largest payload, for building one frame
+// on the stack.
+struct CanFrameBuffer {
+    CanFrame frame;
+    unsigned char payload[CAN_MAX_PAYLOAD];
+};
+
+const uint32_t ETH_MAX_PAYLOAD = 9000;     // jumbo frame
+
+// Ethernet frame handed to the CAPL DLL, the payload follows the 16 byte
+// header directly. Frames live in an EthFramePool buffer and are passed by
+// pointer; the DLL must copy what it keeps beyond the call.
+struct EthFrame {
+    int64_t timestamp_ns;
+    uint32_t channel;
+    uint8_t direction;          // 0 Rx, 1 Tx
+    uint8_t reserved;
+    uint16_t length;            // payload bytes, at most ETH_MAX_PAYLOAD
+
+    unsigned char* Data() { return reinterpret_cast<unsigned char*>(this + 1); }
+    const unsigned char* Data() const { return reinterpret_cast<const unsigned char*>(this + 1); }
+};
+
+static_assert(sizeof(EthFrame) == 16, "EthFrame header must stay 16 bytes");
+
+const uint32_t FLEXRAY_MAX_PAYLOAD = 254;
+const uint8_t FLEXRAY_CHANNEL_A = 1;
+const uint8_t FLEXRAY_CHANNEL_B = 2;
+
+// FlexRay frame as sent by the schedule in one slot of one cycle.
+struct FlexrayFrame {
     int64_t timestamp_ns;
-    unsigned long type;
-    unsigned long dlc;
-    unsigned long rtr;
-    unsigned long fdf;
-    unsigned long brs;
-    unsigned long esi;
-    unsigned char data[64];  // matches payload[]
+    uint16_t slot;              // 1..2047
+    uint8_t cycle;              // 0..63
+    uint8_t channelMask;        // FLEXRAY_CHANNEL_A | FLEXRAY_CHANNEL_B
+    uint8_t length;             // payload bytes
+    uint8_t reserved[3];
+    unsigned char payload[FLEXRAY_MAX_PAYLOAD];
 };
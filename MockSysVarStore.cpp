@@ -0,0 +1,1101 @@
+#include "MockSysVarStore.h"
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+    const int32_t ROOT = 0;
+    const int32_t NO_VARIABLE = -1;
+
+    VIAResult copyName(const std::string& name, char* buffer, int32 bufferLength)
+    {
+        if (buffer == nullptr || bufferLength <= static_cast<int32>(name.size()))
+        {
+            return kVIA_BufferToSmall;
+        }
+        memcpy(buffer, name.c_str(), name.size() + 1);
+        return kVIA_OK;
+    }
+
+    const uint32_t MAX_STRING = 0x7FFFFFFF;
+
+    int64_t normalizeInteger(int64_t value, bool isSigned, bool is64bit)
+    {
+        if (is64bit)
+        {
+            return value;
+        }
+        return isSigned ? static_cast<int64_t>(static_cast<int32_t>(value)) : static_cast<int64_t>(static_cast<uint32_t>(value));
+    }
+}
+
+// --- PathIndex ---
+
+MockSysVarStore::PathIndex::PathIndex()
+    : m_used(0)
+    , m_tombstones(0)
+{
+}
+
+void MockSysVarStore::PathIndex::Insert(uint64_t hash, int32_t id)
+{
+    if ((m_used + m_tombstones + 1) * 4 > m_slots.size() * 3)
+    {
+        size_t size = 16;
+        while (size < (m_used + 1) * 2)
+        {
+            size *= 2;
+        }
+        rehash(size);
+    }
+    size_t mask = m_slots.size() - 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (m_slots[i].id != EMPTY && m_slots[i].id != TOMBSTONE)
+    {
+        i = (i + 1) & mask;
+    }
+    if (m_slots[i].id == TOMBSTONE)
+    {
+        m_tombstones--;
+    }
+    m_slots[i].hash = hash;
+    m_slots[i].id = id;
+    m_used++;
+}
+
+void MockSysVarStore::PathIndex::Erase(uint64_t hash, int32_t id)
+{
+    if (m_slots.empty())
+    {
+        return;
+    }
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; m_slots[i].id != EMPTY; i = (i + 1) & mask)
+    {
+        if (m_slots[i].id == id)
+        {
+            m_slots[i].id = TOMBSTONE;
+            m_used--;
+            m_tombstones++;
+            return;
+        }
+    }
+}
+
+void MockSysVarStore::PathIndex::Clear()
+{
+    m_slots.clear();
+    m_used = 0;
+    m_tombstones = 0;
+}
+
+void MockSysVarStore::PathIndex::rehash(size_t size)
+{
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    Slot empty = { 0, EMPTY };
+    m_slots.assign(size, empty);
+    m_tombstones = 0;
+    size_t mask = size - 1;
+    for (size_t j = 0; j < old.size(); ++j)
+    {
+        if (old[j].id < 0)
+        {
+            continue;
+        }
+        size_t i = static_cast<size_t>(old[j].hash) & mask;
+        while (m_slots[i].id != EMPTY)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = old[j];
+    }
+}
+
+// --- Namespace ---
+
+// Namespace objects belong to the store and stay valid until it is reset.
+VIAResult MockSysVarStore::Namespace::Release()
+{
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Namespace::GetName(char* buffer, int32 bufferLength)
+{
+    const std::string& path = store->m_namespaces[id].path;
+    size_t split = path.rfind("::");
+    return copyName(split == std::string::npos ? path : path.substr(split + 2), buffer, bufferLength);
+}
+
+VIAResult MockSysVarStore::Namespace::GetNamespace(const char* path, VIANamespace*& nameSpace)
+{
+    nameSpace = nullptr;
+    if (store->m_namespaces[id].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (path == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    const char* relative = relativePath(path);
+    int32_t found = store->findNamespace(id, relative, strlen(relative));
+    if (found < 0)
+    {
+        return kVIA_ObjectNotFound;
+    }
+    nameSpace = store->m_namespaces[found].object;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Namespace::GetVariable(const char* path, VIASystemVariable*& variable)
+{
+    variable = nullptr;
+    if (store->m_namespaces[id].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (path == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    int32_t index = store->findVariable(id, relativePath(path));
+    if (index < 0)
+    {
+        return kVIA_ObjectNotFound;
+    }
+    variable = store->newHandle(index);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Namespace::AddNamespace(const char* name, VIANamespace*& nameSpace)
+{
+    nameSpace = nullptr;
+    if (store->m_namespaces[id].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (name == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    const char* relative = relativePath(name);
+    int32_t added = store->addNamespace(id, relative, strlen(relative));
+    if (added < 0)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    nameSpace = store->m_namespaces[added].object;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Namespace::AddVariable(const char* name, VIASysVarType type, bool readOnly, VIASysVarClientHandle client,
+                                                  VIASystemVariable*& variable)
+{
+    return store->addVariable(id, name, type, 0, readOnly, client, variable);
+}
+
+VIAResult MockSysVarStore::Namespace::AddArrayVariable(const char* name, VIASysVarType type, uint32 arrayLength, bool readOnly,
+                                                       VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    if (type != kVIA_SVIntegerArray && type != kVIA_SVFloatArray)
+    {
+        variable = nullptr;
+        return kVIA_ParameterInvalid;
+    }
+    return store->addVariable(id, name, type, arrayLength, readOnly, client, variable);
+}
+
+VIAResult MockSysVarStore::Namespace::RemoveVariable(const char* name, VIASysVarClientHandle client)
+{
+    if (store->m_namespaces[id].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    int32_t index = name != nullptr ? store->findVariable(id, relativePath(name)) : -1;
+    if (index < 0)
+    {
+        return kVIA_ObjectNotFound;
+    }
+    return store->removeVariable(index, client);
+}
+
+VIAResult MockSysVarStore::Namespace::RemoveNamespace(const char* name, VIASysVarClientHandle client)
+{
+    if (store->m_namespaces[id].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    const char* relative = name != nullptr ? relativePath(name) : "";
+    int32_t found = *relative != '\0' ? store->findNamespace(id, relative, strlen(relative)) : -1;
+    if (found < 0)
+    {
+        return kVIA_ObjectNotFound;
+    }
+    return store->removeNamespace(found, client);
+}
+
+VIAResult MockSysVarStore::Namespace::SetComment(const char* comment)
+{
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Namespace::AddIntVariableWithInitialValue(const char* name, int32 initialValue, bool readOnly,
+                                                                     VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    VIAResult result = store->addVariable(id, name, kVIA_SVInteger, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        store->m_integers[store->m_variables[static_cast<Variable*>(variable)->index].offset] = initialValue;
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddFloatVariableWithInitialValue(const char* name, double initialValue, bool readOnly,
+                                                                       VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    VIAResult result = store->addVariable(id, name, kVIA_SVFloat, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        store->m_floats[store->m_variables[static_cast<Variable*>(variable)->index].offset] = initialValue;
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddStringVariableWithInitialValue(const char* name, const char* initialValue, bool readOnly,
+                                                                        VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    VIAResult result = store->addVariable(id, name, kVIA_SVString, 0, readOnly, client, variable);
+    if (result == kVIA_OK && initialValue != nullptr)
+    {
+        store->assign(store->m_bytes, store->m_variables[static_cast<Variable*>(variable)->index],
+                      reinterpret_cast<const uint8_t*>(initialValue), static_cast<uint32_t>(strlen(initialValue)));
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddIntArrayVariableWithInitialValue(const char* name, const int32* initialValue, int32 length,
+                                                                          bool readOnly, VIASysVarClientHandle client,
+                                                                          VIASystemVariable*& variable)
+{
+    if (length < 0 || (length > 0 && initialValue == nullptr))
+    {
+        variable = nullptr;
+        return kVIA_ParameterInvalid;
+    }
+    VIAResult result = store->addVariable(id, name, kVIA_SVIntegerArray, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_integerArrays, store->m_variables[static_cast<Variable*>(variable)->index],
+                      initialValue, static_cast<uint32_t>(length));
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddFloatArrayVariableWithInitialValue(const char* name, const double* initialValue, int32 length,
+                                                                            bool readOnly, VIASysVarClientHandle client,
+                                                                            VIASystemVariable*& variable)
+{
+    if (length < 0 || (length > 0 && initialValue == nullptr))
+    {
+        variable = nullptr;
+        return kVIA_ParameterInvalid;
+    }
+    VIAResult result = store->addVariable(id, name, kVIA_SVFloatArray, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_floats, store->m_variables[static_cast<Variable*>(variable)->index],
+                      initialValue, static_cast<uint32_t>(length));
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddDataVariableWithInitialValue(const char* name, const uint8* initialValue, int32 length,
+                                                                      bool readOnly, VIASysVarClientHandle client,
+                                                                      VIASystemVariable*& variable)
+{
+    if (length < 0 || (length > 0 && initialValue == nullptr))
+    {
+        variable = nullptr;
+        return kVIA_ParameterInvalid;
+    }
+    VIAResult result = store->addVariable(id, name, kVIA_SVData, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_bytes, store->m_variables[static_cast<Variable*>(variable)->index],
+                      initialValue, static_cast<uint32_t>(length));
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddIntVariable(const char* name, bool isSigned, bool is64bit, bool readOnly,
+                                                     VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    return AddIntVariableWithInitialValueEx(name, 0, isSigned, is64bit, readOnly, client, variable);
+}
+
+VIAResult MockSysVarStore::Namespace::AddIntVariableWithInitialValueEx(const char* name, ::int64 initialValue, bool isSigned,
+                                                                       bool is64bit, bool readOnly, VIASysVarClientHandle client,
+                                                                       VIASystemVariable*& variable)
+{
+    VIAResult result = store->addVariable(id, name, kVIA_SVInteger, 0, readOnly, client, variable);
+    if (result == kVIA_OK)
+    {
+        VariableEntry& entry = store->m_variables[static_cast<Variable*>(variable)->index];
+        entry.isSigned = isSigned;
+        entry.is64bit = is64bit;
+        store->m_integers[entry.offset] = normalizeInteger(initialValue, isSigned, is64bit);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Namespace::AddStringVariableWithInitialValueEx(const char* name, const char* initialValue, uint32 codepage,
+                                                                          bool readOnly, VIASysVarClientHandle client,
+                                                                          VIASystemVariable*& variable)
+{
+    return AddStringVariableWithInitialValue(name, initialValue, readOnly, client, variable);
+}
+
+// --- Variable ---
+
+VIAResult MockSysVarStore::Variable::Release()
+{
+    store->releaseHandle(this);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::GetType(VIASysVarType* type)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    *type = entry->type;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::GetName(char* buffer, int32 bufferLength)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    return copyName(entry->path.substr(entry->nameOffset), buffer, bufferLength);
+}
+
+VIAResult MockSysVarStore::Variable::SetSink(VIAOnSysVar* newSink)
+{
+    store->setSink(this, newSink);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetInteger(int32 x, VIASysVarClientHandle client)
+{
+    return SetIntegerEx(x, client);
+}
+
+VIAResult MockSysVarStore::Variable::GetInteger(int32* x)
+{
+    ::int64 value;
+    VIAResult result = GetIntegerEx(&value);
+    if (result == kVIA_OK)
+    {
+        *x = static_cast<int32>(value);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::SetFloat(double x, VIASysVarClientHandle client)
+{
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVFloat, client, entry);
+    if (result == kVIA_OK)
+    {
+        store->m_floats[entry->offset] = x;
+        store->markDirty(index);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::GetFloat(double* x)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVFloat)
+    {
+        return kVIA_Failed;
+    }
+    *x = store->m_floats[entry->offset];
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetString(const char* text, VIASysVarClientHandle client)
+{
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVString, client, entry);
+    if (result == kVIA_OK)
+    {
+        size_t length = text != nullptr ? strlen(text) : 0;
+        if (length > MAX_STRING)
+        {
+            return kVIA_ParameterInvalid;
+        }
+        store->assign(store->m_bytes, *entry, reinterpret_cast<const uint8_t*>(text), static_cast<uint32_t>(length));
+        store->markDirty(index);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::GetString(char* buffer, int32 bufferLength)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVString)
+    {
+        return kVIA_Failed;
+    }
+    if (buffer == nullptr || bufferLength <= static_cast<int32>(entry->length))
+    {
+        return kVIA_BufferToSmall;
+    }
+    memcpy(buffer, store->m_bytes.data() + entry->offset, entry->length);
+    buffer[entry->length] = '\0';
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetIntegerArray(const int32* x, int32 length, VIASysVarClientHandle client)
+{
+    if (length < 0 || (length > 0 && x == nullptr))
+    {
+        return kVIA_ParameterInvalid;
+    }
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVIntegerArray, client, entry);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_integerArrays, *entry, x, static_cast<uint32_t>(length));
+        store->markDirty(index);
+    }
+    return result;
+}
+
+// Copies as many elements as both the array and the buffer hold.
+VIAResult MockSysVarStore::Variable::GetIntegerArray(int32* x, int32 length)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVIntegerArray)
+    {
+        return kVIA_Failed;
+    }
+    uint32_t count = std::min(entry->length, static_cast<uint32_t>(std::max(length, 0)));
+    std::copy(store->m_integerArrays.begin() + entry->offset, store->m_integerArrays.begin() + entry->offset + count, x);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetFloatArray(const double* x, int32 length, VIASysVarClientHandle client)
+{
+    if (length < 0 || (length > 0 && x == nullptr))
+    {
+        return kVIA_ParameterInvalid;
+    }
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVFloatArray, client, entry);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_floats, *entry, x, static_cast<uint32_t>(length));
+        store->markDirty(index);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::GetFloatArray(double* x, int32 length)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVFloatArray)
+    {
+        return kVIA_Failed;
+    }
+    uint32_t count = std::min(entry->length, static_cast<uint32_t>(std::max(length, 0)));
+    std::copy(store->m_floats.begin() + entry->offset, store->m_floats.begin() + entry->offset + count, x);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::GetArraySize(int32* size)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVIntegerArray && entry->type != kVIA_SVFloatArray && entry->type != kVIA_SVData)
+    {
+        return kVIA_Failed;
+    }
+    *size = static_cast<int32>(entry->length);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::IsReadOnly(int32* readOnly)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    *readOnly = entry->readOnly ? 1 : 0;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetComment(const char* comment)
+{
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetData(const uint8* x, int32 length, VIASysVarClientHandle client)
+{
+    if (length < 0 || (length > 0 && x == nullptr))
+    {
+        return kVIA_ParameterInvalid;
+    }
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVData, client, entry);
+    if (result == kVIA_OK)
+    {
+        store->assign(store->m_bytes, *entry, x, static_cast<uint32_t>(length));
+        store->markDirty(index);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::GetData(uint8* buffer, int32 bufferSize, int32* copiedBytes)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVData)
+    {
+        return kVIA_Failed;
+    }
+    uint32_t count = std::min(entry->length, static_cast<uint32_t>(std::max(bufferSize, 0)));
+    memcpy(buffer, store->m_bytes.data() + entry->offset, count);
+    if (copiedBytes != nullptr)
+    {
+        *copiedBytes = static_cast<int32>(count);
+    }
+    return count < entry->length ? kVIA_BufferToSmall : kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetUnit(const char* unit)
+{
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::IsSigned(bool* isSigned)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVInteger)
+    {
+        return kVIA_Failed;
+    }
+    *isSigned = entry->isSigned;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::Variable::SetIntegerEx(::int64 x, VIASysVarClientHandle client)
+{
+    VariableEntry* entry;
+    VIAResult result = store->beginWrite(this, kVIA_SVInteger, client, entry);
+    if (result == kVIA_OK)
+    {
+        store->m_integers[entry->offset] = normalizeInteger(x, entry->isSigned, entry->is64bit);
+        store->markDirty(index);
+    }
+    return result;
+}
+
+VIAResult MockSysVarStore::Variable::GetIntegerEx(::int64* x)
+{
+    VariableEntry* entry = store->entry(this);
+    if (entry == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (entry->type != kVIA_SVInteger)
+    {
+        return kVIA_Failed;
+    }
+    *x = store->m_integers[entry->offset];
+    return kVIA_OK;
+}
+
+// Strings are kept as the bytes they were set with, whatever the codepage.
+VIAResult MockSysVarStore::Variable::SetStringWithEncoding(const char* text, VIASysVarClientHandle client, uint32 codepage)
+{
+    return SetString(text, client);
+}
+
+VIAResult MockSysVarStore::Variable::GetStringInEncoding(char* buffer, int32 bufferLength, uint32 codepage)
+{
+    return GetString(buffer, bufferLength);
+}
+
+// --- MockSysVarStore ---
+
+MockSysVarStore::MockSysVarStore()
+    : m_liveVariables(0)
+    , m_dispatchVariable(NO_VARIABLE)
+    , m_watcherHoles(false)
+    , m_writes(0)
+    , m_notifications(0)
+{
+    Reset();
+}
+
+MockSysVarStore::~MockSysVarStore()
+{
+    for (size_t i = 0; i < m_handles.size(); ++i)
+    {
+        delete m_handles[i];
+    }
+    for (size_t i = 0; i < m_namespaces.size(); ++i)
+    {
+        delete m_namespaces[i].object;
+    }
+}
+
+VIANamespace* MockSysVarStore::Root()
+{
+    return m_namespaces[ROOT].object;
+}
+
+void MockSysVarStore::Reset()
+{
+    for (size_t i = 0; i < m_handles.size(); ++i)
+    {
+        delete m_handles[i];
+    }
+    m_handles.clear();
+    for (size_t i = 0; i < m_namespaces.size(); ++i)
+    {
+        delete m_namespaces[i].object;
+    }
+    m_namespaces.clear();
+    m_variables.clear();
+    m_namespaceIndex.Clear();
+    m_variableIndex.Clear();
+    m_liveVariables = 0;
+    m_integers.clear();
+    m_floats.clear();
+    m_integerArrays.clear();
+    m_bytes.clear();
+    m_dirty.clear();
+    m_dirtyWords.clear();
+    m_dispatchDirty.clear();
+    m_dispatchWords.clear();
+
+    NamespaceEntry root;
+    root.hash = FNV_OFFSET;
+    root.object = new Namespace(this, ROOT);
+    root.removed = false;
+    m_namespaces.push_back(root);
+}
+
+uint64_t MockSysVarStore::hashPath(uint64_t hash, const char* path, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(path[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Whether full is prefix::path, or path for the root.
+bool MockSysVarStore::pathEquals(const std::string& full, const std::string& prefix, const char* path, size_t length)
+{
+    if (prefix.empty())
+    {
+        return full.size() == length && full.compare(0, length, path, length) == 0;
+    }
+    return full.size() == prefix.size() + 2 + length &&
+           full.compare(0, prefix.size(), prefix) == 0 &&
+           full[prefix.size()] == ':' && full[prefix.size() + 1] == ':' &&
+           full.compare(prefix.size() + 2, length, path, length) == 0;
+}
+
+const char* MockSysVarStore::relativePath(const char* path)
+{
+    return path[0] == ':' && path[1] == ':' ? path + 2 : path;
+}
+
+// Hash of the path below namespaceId, continued from the hash of the
+// namespace instead of hashing the full path again.
+uint64_t MockSysVarStore::childHash(int32_t namespaceId, const char* path, size_t length) const
+{
+    uint64_t hash = m_namespaces[namespaceId].hash;
+    if (namespaceId != ROOT)
+    {
+        hash = hashPath(hash, "::", 2);
+    }
+    return hashPath(hash, path, length);
+}
+
+int32_t MockSysVarStore::findNamespace(int32_t base, const char* path, size_t length) const
+{
+    const std::string& prefix = m_namespaces[base].path;
+    return m_namespaceIndex.Find(childHash(base, path, length), [&](int32_t id) {
+        return pathEquals(m_namespaces[id].path, prefix, path, length);
+    });
+}
+
+int32_t MockSysVarStore::findVariable(int32_t base, const char* path) const
+{
+    size_t length = strlen(path);
+    const std::string& prefix = m_namespaces[base].path;
+    return m_variableIndex.Find(childHash(base, path, length), [&](int32_t index) {
+        return pathEquals(m_variables[index].path, prefix, path, length);
+    });
+}
+
+// Adds the namespaces of path below base that do not exist yet and returns
+// the last one, or -1 for an empty path component.
+int32_t MockSysVarStore::addNamespace(int32_t base, const char* path, size_t length)
+{
+    int32_t current = base;
+    size_t begin = 0;
+    for (;;)
+    {
+        const char* separator = static_cast<const char*>(memmem(path + begin, length - begin, "::", 2));
+        size_t end = separator != nullptr ? static_cast<size_t>(separator - path) : length;
+        if (end == begin)
+        {
+            return -1;
+        }
+        int32_t found = findNamespace(current, path + begin, end - begin);
+        if (found < 0)
+        {
+            NamespaceEntry added;
+            const std::string& parent = m_namespaces[current].path;
+            added.path = parent.empty() ? std::string(path + begin, end - begin)
+                                        : parent + "::" + std::string(path + begin, end - begin);
+            added.hash = childHash(current, path + begin, end - begin);
+            found = static_cast<int32_t>(m_namespaces.size());
+            added.object = new Namespace(this, found);
+            added.removed = false;
+            m_namespaces.push_back(added);
+            m_namespaceIndex.Insert(added.hash, found);
+        }
+        current = found;
+        if (end == length)
+        {
+            return current;
+        }
+        begin = end + 2;
+    }
+}
+
+VIAResult MockSysVarStore::addVariable(int32_t base, const char* name, VIASysVarType type, uint32_t length, bool readOnly,
+                                       VIASysVarClientHandle client, VIASystemVariable*& variable)
+{
+    variable = nullptr;
+    if (m_namespaces[base].removed)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (name == nullptr || type < kVIA_SVInteger || type > kVIA_SVData)
+    {
+        return kVIA_ParameterInvalid;
+    }
+
+    // A name with namespaces adds them as needed
+    const char* path = relativePath(name);
+    const char* leaf = path;
+    for (const char* separator = strstr(path, "::"); separator != nullptr; separator = strstr(separator + 2, "::"))
+    {
+        leaf = separator + 2;
+    }
+    int32_t namespaceId = base;
+    if (leaf != path)
+    {
+        namespaceId = addNamespace(base, path, static_cast<size_t>(leaf - 2 - path));
+        if (namespaceId < 0)
+        {
+            return kVIA_ParameterInvalid;
+        }
+    }
+    size_t leafLength = strlen(leaf);
+    if (leafLength == 0)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    if (findVariable(namespaceId, leaf) >= 0)
+    {
+        return kVIA_ObjectCreationFailed;
+    }
+
+    VariableEntry added;
+    const std::string& parent = m_namespaces[namespaceId].path;
+    added.path = parent.empty() ? std::string(leaf) : parent + "::" + leaf;
+    added.nameOffset = added.path.size() - leafLength;
+    added.hash = childHash(namespaceId, leaf, leafLength);
+    added.namespaceId = namespaceId;
+    added.type = type;
+    added.readOnly = readOnly;
+    added.isSigned = true;
+    added.is64bit = false;
+    added.removed = false;
+    added.client = client;
+    added.length = 0;
+    added.capacity = 0;
+    switch (type)
+    {
+    case kVIA_SVInteger:
+        added.offset = static_cast<uint32_t>(m_integers.size());
+        added.length = added.capacity = 1;
+        m_integers.push_back(0);
+        break;
+    case kVIA_SVFloat:
+        added.offset = static_cast<uint32_t>(m_floats.size());
+        added.length = added.capacity = 1;
+        m_floats.push_back(0.0);
+        break;
+    case kVIA_SVIntegerArray:
+        added.offset = static_cast<uint32_t>(m_integerArrays.size());
+        added.length = added.capacity = length;
+        m_integerArrays.resize(m_integerArrays.size() + length, 0);
+        break;
+    case kVIA_SVFloatArray:
+        added.offset = static_cast<uint32_t>(m_floats.size());
+        added.length = added.capacity = length;
+        m_floats.resize(m_floats.size() + length, 0.0);
+        break;
+    default:
+        added.offset = static_cast<uint32_t>(m_bytes.size());
+        break;
+    }
+
+    int32_t index = static_cast<int32_t>(m_variables.size());
+    m_variables.push_back(added);
+    m_variableIndex.Insert(added.hash, index);
+    m_liveVariables++;
+
+    size_t words = (static_cast<size_t>(index) >> 6) + 1;
+    if (m_dirty.size() < words)
+    {
+        m_dirty.resize(words, 0);
+        m_dispatchDirty.resize(words, 0);
+        m_dirtyWords.resize((words + 63) >> 6, 0);
+        m_dispatchWords.resize((words + 63) >> 6, 0);
+    }
+
+    variable = newHandle(index);
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::removeVariable(int32_t index, VIASysVarClientHandle client)
+{
+    VariableEntry& variable = m_variables[index];
+    if (variable.client != client)
+    {
+        return kVIA_Failed;
+    }
+    // Handles stay valid as objects but report kVIA_ObjectInvalid
+    variable.removed = true;
+    variable.watchers.clear();
+    m_variableIndex.Erase(variable.hash, index);
+    m_liveVariables--;
+    return kVIA_OK;
+}
+
+VIAResult MockSysVarStore::removeNamespace(int32_t id, VIASysVarClientHandle client)
+{
+    if (id == ROOT)
+    {
+        return kVIA_Failed;
+    }
+    std::string prefix = m_namespaces[id].path + "::";
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        const VariableEntry& variable = m_variables[i];
+        if (!variable.removed && variable.path.compare(0, prefix.size(), prefix) == 0 && variable.client != client)
+        {
+            return kVIA_Failed;
+        }
+    }
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        if (!m_variables[i].removed && m_variables[i].path.compare(0, prefix.size(), prefix) == 0)
+        {
+            removeVariable(static_cast<int32_t>(i), client);
+        }
+    }
+    for (size_t i = 0; i < m_namespaces.size(); ++i)
+    {
+        NamespaceEntry& nameSpace = m_namespaces[i];
+        if (!nameSpace.removed && (static_cast<int32_t>(i) == id || nameSpace.path.compare(0, prefix.size(), prefix) == 0))
+        {
+            nameSpace.removed = true;
+            m_namespaceIndex.Erase(nameSpace.hash, static_cast<int32_t>(i));
+        }
+    }
+    return kVIA_OK;
+}
+
+MockSysVarStore::Variable* MockSysVarStore::newHandle(int32_t index)
+{
+    Variable* handle = new Variable(this, index);
+    handle->handleSlot = m_handles.size();
+    m_handles.push_back(handle);
+    return handle;
+}
+
+void MockSysVarStore::releaseHandle(Variable* handle)
+{
+    setSink(handle, nullptr);
+    Variable* last = m_handles.back();
+    m_handles[handle->handleSlot] = last;
+    last->handleSlot = handle->handleSlot;
+    m_handles.pop_back();
+    delete handle;
+}
+
+void MockSysVarStore::setSink(Variable* handle, VIAOnSysVar* sink)
+{
+    std::vector<Variable*>& watchers = m_variables[handle->index].watchers;
+    if (handle->sink != nullptr && sink == nullptr)
+    {
+        std::vector<Variable*>::iterator it = std::find(watchers.begin(), watchers.end(), handle);
+        if (it != watchers.end() && handle->index == m_dispatchVariable)
+        {
+            *it = nullptr;
+            m_watcherHoles = true;
+        }
+        else if (it != watchers.end())
+        {
+            watchers.erase(it);
+        }
+    }
+    else if (handle->sink == nullptr && sink != nullptr && !m_variables[handle->index].removed)
+    {
+        watchers.push_back(handle);
+    }
+    handle->sink = sink;
+}
+
+MockSysVarStore::VariableEntry* MockSysVarStore::entry(const Variable* handle)
+{
+    VariableEntry& variable = m_variables[handle->index];
+    return variable.removed ? nullptr : &variable;
+}
+
+VIAResult MockSysVarStore::beginWrite(const Variable* handle, VIASysVarType type, VIASysVarClientHandle client,
+                                      VariableEntry*& variable)
+{
+    variable = entry(handle);
+    if (variable == nullptr)
+    {
+        return kVIA_ObjectInvalid;
+    }
+    if (variable->type != type || (variable->readOnly && client != variable->client))
+    {
+        return kVIA_Failed;
+    }
+    return kVIA_OK;
+}
+
+// Stores length values of the variable, moving it to the end of the slab
+// when it does not fit into its room any more.
+template <typename T>
+void MockSysVarStore::assign(std::vector<T>& slab, VariableEntry& variable, const T* values, uint32_t length)
+{
+    if (length > variable.capacity)
+    {
+        variable.capacity = std::max(length, variable.capacity * 2);
+        variable.offset = static_cast<uint32_t>(slab.size());
+        slab.resize(slab.size() + variable.capacity);
+    }
+    if (length > 0)
+    {
+        memcpy(&slab[variable.offset], values, length * sizeof(T));
+    }
+    variable.length = length;
+}
+
+void MockSysVarStore::markDirty(int32_t index)
+{
+    size_t word = static_cast<size_t>(index) >> 6;
+    if (m_dirty[word] == 0)
+    {
+        m_dirtyWords[word >> 6] |= 1ull << (word & 63);
+    }
+    m_dirty[word] |= 1ull << (index & 63);
+    m_writes++;
+}
+
+void MockSysVarStore::DispatchChanges(VIATime now)
+{
+    m_dirty.swap(m_dispatchDirty);
+    m_dirtyWords.swap(m_dispatchWords);
+    for (size_t summary = 0; summary < m_dispatchWords.size(); ++summary)
+    {
+        uint64_t words = m_dispatchWords[summary];
+        m_dispatchWords[summary] = 0;
+        while (words != 0)
+        {
+            size_t word = (summary << 6) + __builtin_ctzll(words);
+            words &= words - 1;
+            uint64_t bits = m_dispatchDirty[word];
+            m_dispatchDirty[word] = 0;
+            while (bits != 0)
+            {
+                int32_t index = static_cast<int32_t>((word << 6) + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                // Sinks may add variables or release handles, so the entry
+                // is looked up again for every watcher. Released watchers
+                // leave a null behind until the loop is done.
+                m_dispatchVariable = index;
+                for (size_t i = 0; i < m_variables[index].watchers.size(); ++i)
+                {
+                    Variable* handle = m_variables[index].watchers[i];
+                    if (handle == nullptr)
+                    {
+                        continue;
+                    }
+                    handle->sink->OnSysVar(now, handle);
+                    m_notifications++;
+                }
+                m_dispatchVariable = NO_VARIABLE;
+                if (m_watcherHoles)
+                {
+                    std::vector<Variable*>& watchers = m_variables[index].watchers;
+                    watchers.erase(std::remove(watchers.begin(), watchers.end(), static_cast<Variable*>(nullptr)), watchers.end());
+                    m_watcherHoles = false;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "VIA.h"
+
+// System variables of one CAPL instance, reached through
+// VIAService::GetSystemVariablesRootNamespace.
+//
+// Every variable is one entry of a flat table. Paths are looked up by their
+// FNV-1a hash in an open-addressing index; a namespace keeps the hash of its
+// own path, so a lookup relative to it only hashes the remaining part. The
+// values live in typed slabs (64 bit integers, doubles, int32 arrays and
+// bytes for strings and data) addressed by offset, so a write is a copy
+// into the slab and never allocates unless a string or array outgrows its
+// room; it then moves to the end of its slab.
+//
+// A write only sets the bit of the variable in a dirty bitmap. Once per tick
+// DispatchChanges() walks the bitmap, guided by a summary bitmap of the
+// non-zero words, and calls each sink once per changed variable, however
+// often it was written. Writes from inside a sink are reported in the next
+// dispatch.
+//
+// Struct, generic array and union variables are not supported.
+class MockSysVarStore
+{
+public:
+    MockSysVarStore();
+    ~MockSysVarStore();
+
+    VIANamespace* Root();
+    // Drops every variable and handle, e.g. when the library that created
+    // them is gone.
+    void Reset();
+
+    void DispatchChanges(VIATime now);
+
+    size_t VariableCount() const { return m_liveVariables; }
+    uint64_t Writes() const { return m_writes; }
+    uint64_t Notifications() const { return m_notifications; }
+
+private:
+    MockSysVarStore(const MockSysVarStore&);
+    MockSysVarStore& operator=(const MockSysVarStore&);
+
+    class Variable;
+
+    class Namespace final : public VIANamespace
+    {
+    public:
+        Namespace(MockSysVarStore* store, int32_t id) : store(store), id(id) {}
+
+        VIASTDDECL Release() override;
+        VIASTDDECL GetName(char* buffer, int32 bufferLength) override;
+        VIASTDDECL GetNamespace(const char* path, VIANamespace*& nameSpace) override;
+        VIASTDDECL GetVariable(const char* path, VIASystemVariable*& variable) override;
+        VIASTDDECL AddNamespace(const char* name, VIANamespace*& nameSpace) override;
+        VIASTDDECL AddVariable(const char* name, VIASysVarType type, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddArrayVariable(const char* name, VIASysVarType type, uint32 arrayLength, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL RemoveVariable(const char* name, VIASysVarClientHandle client) override;
+        VIASTDDECL RemoveNamespace(const char* name, VIASysVarClientHandle client) override;
+        VIASTDDECL SetComment(const char* comment) override;
+        VIASTDDECL AddIntVariableWithInitialValue(const char* name, int32 initialValue, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddFloatVariableWithInitialValue(const char* name, double initialValue, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddStringVariableWithInitialValue(const char* name, const char* initialValue, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddIntArrayVariableWithInitialValue(const char* name, const int32* initialValue, int32 length, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddFloatArrayVariableWithInitialValue(const char* name, const double* initialValue, int32 length, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddDataVariableWithInitialValue(const char* name, const uint8* initialValue, int32 length, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddStruct(const char* name, VIASysVarClientHandle client, VIASVStructDefinition** structDefinition) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddStructVariable(const char* name, const char* structPath, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddGenericArrayVariable(const char* name, int32 arrayLength, VIASVArrayElementDefinition* arrayElementDefinition, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL CreateArrayElementDefinition(VIASVArrayElementDefinition** arrayElementDefinition) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddIntVariable(const char* name, bool isSigned, bool is64bit, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddIntVariableWithInitialValueEx(const char* name, ::int64 initialValue, bool isSigned, bool is64bit, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddStringVariableWithInitialValueEx(const char* name, const char* initialValue, uint32 codepage, bool readOnly, VIASysVarClientHandle client, VIASystemVariable*& variable) override;
+        VIASTDDECL AddStructVariableWithMemberInitValues(const char* name, const char* structPath, bool readOnly, VIASysVarClientHandle client, VIASystemVariableMemberInitValues* memberInitValues, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddGenericArrayVariableWithMemberInitValues(const char* name, int32 arrayLength, VIASVArrayElementDefinition* arrayElementDefinition, bool readOnly, VIASysVarClientHandle client, VIASystemVariableMemberInitValues* memberInitValues, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL CreateMemberInitValues(VIASystemVariableMemberInitValues*& memberInitValues) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL ReleaseMemberInitValues(VIASystemVariableMemberInitValues* memberInitValues) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddGenericArrayVariableWithoutBinaryLayout(const char* name, int32 arrayLength, VIASVArrayElementDefinition* arrayElementDefinition, bool readOnly, VIASysVarClientHandle client,VIASystemVariableMemberInitValues* memberInitValues, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL AddVariableLengthArrayVariable(const char* name, int32 arrayLength, int32 minLength, int32 maxLength, VIASVArrayElementDefinition* arrayElementDefinition, bool readOnly, VIASysVarClientHandle client, VIASystemVariableMemberInitValues* memberInitValues, VIASystemVariable*& variable) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL GetSystemVariableIterator(VIASystemVariableIterator** iterator, bool unveilConcealed) override { return kVIA_FunctionNotImplemented; }
+
+        MockSysVarStore* store;
+        int32_t id;
+    };
+
+    // One handle per GetVariable/AddVariable, with its own sink
+    class Variable final : public VIASystemVariable
+    {
+    public:
+        Variable(MockSysVarStore* store, int32_t index) : store(store), index(index), sink(nullptr), handleSlot(0) {}
+
+        VIASTDDECL Release() override;
+        VIASTDDECL GetType(VIASysVarType* type) override;
+        VIASTDDECL GetName(char* buffer, int32 bufferLength) override;
+        VIASTDDECL SetSink(VIAOnSysVar* sink) override;
+        VIASTDDECL SetInteger(int32 x, VIASysVarClientHandle client) override;
+        VIASTDDECL GetInteger(int32* x) override;
+        VIASTDDECL SetFloat(double x, VIASysVarClientHandle client) override;
+        VIASTDDECL GetFloat(double* x) override;
+        VIASTDDECL SetString(const char* text, VIASysVarClientHandle client) override;
+        VIASTDDECL GetString(char* buffer, int32 bufferLength) override;
+        VIASTDDECL SetIntegerArray(const int32* x, int32 length, VIASysVarClientHandle client) override;
+        VIASTDDECL GetIntegerArray(int32* x, int32 length) override;
+        VIASTDDECL SetFloatArray(const double* x, int32 length, VIASysVarClientHandle client) override;
+        VIASTDDECL GetFloatArray(double* x, int32 length) override;
+        VIASTDDECL GetArraySize(int32* size) override;
+        VIASTDDECL IsReadOnly(int32* readOnly) override;
+        VIASTDDECL SetComment(const char* comment) override;
+        VIASTDDECL SetSymbolicValueName(int32 value, const char* name) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL GetSymbolicValueName(int32 value, char* buffer, int32 bufferLength) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL SetData(const uint8* x, int32 length, VIASysVarClientHandle client) override;
+        VIASTDDECL GetData(uint8* buffer, int32 bufferSize, int32* copiedBytes) override;
+        VIASTDDECL SetUnit(const char* unit) override;
+        VIASTDDECL GetMember(const char* memberPath, VIASystemVariableMember** member) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL BeginStructUpdate(VIASysVarClientHandle client) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL EndStructUpdate() override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL IsSigned(bool* isSigned) override;
+        VIASTDDECL SetIntegerEx(::int64 x, VIASysVarClientHandle client) override;
+        VIASTDDECL GetIntegerEx(::int64* x) override;
+        VIASTDDECL SetStringWithEncoding(const char* text, VIASysVarClientHandle client, uint32 codepage) override;
+        VIASTDDECL GetStringInEncoding(char* buffer, int32 bufferLength, uint32 codepage) override;
+        VIASTDDECL SetArrayLength(int32 length, VIASysVarClientHandle client) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL SetPhysicalValue(double value, VIASysVarClientHandle client) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL GetPhysicalValue(double* value) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL SetPhysicalValues(const double* values, int32 length, VIASysVarClientHandle client) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL GetPhysicalValues(double* values, int32 length) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL GetSimulinkMemoryLayout(uint32* numBlocks, uint32** blockStartsCanoe, uint32** blockStartsSimulink, uint32** blockSizes) override { return kVIA_FunctionNotImplemented; }
+        VIASTDDECL ReleaseSimulinkMemoryLayout(uint32* blockStartsCanoe, uint32* blockStartsSimulink, uint32* blockSizes) override { return kVIA_FunctionNotImplemented; }
+
+        MockSysVarStore* store;
+        int32_t index;
+        VIAOnSysVar* sink;
+        size_t handleSlot;          // position in m_handles
+    };
+
+    struct NamespaceEntry
+    {
+        std::string path;           // "a::b", empty for the root
+        uint64_t hash;
+        Namespace* object;
+        bool removed;
+    };
+
+    struct VariableEntry
+    {
+        std::string path;
+        size_t nameOffset;          // of the last path component
+        uint64_t hash;
+        int32_t namespaceId;
+        VIASysVarType type;
+        bool readOnly;
+        bool isSigned;
+        bool is64bit;
+        bool removed;
+        VIASysVarClientHandle client;
+        uint32_t offset;            // into the slab of the type
+        uint32_t length;            // elements, or bytes without the terminator
+        uint32_t capacity;
+        std::vector<Variable*> watchers;    // handles with a sink
+    };
+
+    // Open addressing over (hash, id); equal hashes are told apart by the
+    // caller's path comparison.
+    class PathIndex
+    {
+    public:
+        PathIndex();
+
+        template <typename Equal>
+        int32_t Find(uint64_t hash, Equal equal) const
+        {
+            if (m_slots.empty())
+            {
+                return -1;
+            }
+            size_t mask = m_slots.size() - 1;
+            for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+            {
+                const Slot& slot = m_slots[i];
+                if (slot.id == EMPTY)
+                {
+                    return -1;
+                }
+                if (slot.id != TOMBSTONE && slot.hash == hash && equal(slot.id))
+                {
+                    return slot.id;
+                }
+            }
+        }
+        void Insert(uint64_t hash, int32_t id);
+        void Erase(uint64_t hash, int32_t id);
+        void Clear();
+
+    private:
+        static const int32_t EMPTY = -1;
+        static const int32_t TOMBSTONE = -2;
+
+        struct Slot
+        {
+            uint64_t hash;
+            int32_t id;
+        };
+
+        void rehash(size_t size);
+
+        std::vector<Slot> m_slots;
+        size_t m_used;
+        size_t m_tombstones;
+    };
+
+    static uint64_t hashPath(uint64_t hash, const char* path, size_t length);
+    static bool pathEquals(const std::string& full, const std::string& prefix, const char* path, size_t length);
+    static const char* relativePath(const char* path);
+
+    uint64_t childHash(int32_t namespaceId, const char* path, size_t length) const;
+    int32_t findNamespace(int32_t base, const char* path, size_t length) const;
+    int32_t findVariable(int32_t base, const char* path) const;
+    int32_t addNamespace(int32_t base, const char* path, size_t length);
+    VIAResult addVariable(int32_t base, const char* name, VIASysVarType type, uint32_t length, bool readOnly,
+                          VIASysVarClientHandle client, VIASystemVariable*& variable);
+    VIAResult removeVariable(int32_t index, VIASysVarClientHandle client);
+    VIAResult removeNamespace(int32_t id, VIASysVarClientHandle client);
+    Variable* newHandle(int32_t index);
+    void releaseHandle(Variable* handle);
+    void setSink(Variable* handle, VIAOnSysVar* sink);
+
+    VariableEntry* entry(const Variable* handle);
+    VIAResult beginWrite(const Variable* handle, VIASysVarType type, VIASysVarClientHandle client, VariableEntry*& variable);
+    void markDirty(int32_t index);
+    template <typename T>
+    void assign(std::vector<T>& slab, VariableEntry& variable, const T* values, uint32_t length);
+
+    std::vector<NamespaceEntry> m_namespaces;
+    std::vector<VariableEntry> m_variables;
+    PathIndex m_namespaceIndex;
+    PathIndex m_variableIndex;
+    size_t m_liveVariables;
+
+    std::vector<int64_t> m_integers;
+    std::vector<double> m_floats;
+    std::vector<int32_t> m_integerArrays;
+    std::vector<uint8_t> m_bytes;
+
+    std::vector<Variable*> m_handles;
+
+    // Bit per variable, and bit per non-zero word of it. Swapped with the
+    // dispatch copies when a dispatch begins.
+    std::vector<uint64_t> m_dirty;
+    std::vector<uint64_t> m_dirtyWords;
+    std::vector<uint64_t> m_dispatchDirty;
+    std::vector<uint64_t> m_dispatchWords;
+    // Variable whose watchers are being notified; handles leaving its
+    // list meanwhile are nulled and compacted afterwards
+    int32_t m_dispatchVariable;
+    bool m_watcherHoles;
+
+    uint64_t m_writes;
+    uint64_t m_notifications;
+};
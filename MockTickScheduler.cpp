@@ -0,0 +1,106 @@
+#include "MockTickScheduler.h"
+#include <cerrno>
+#include <cmath>
+
+namespace
+{
+    constexpr int64_t NS_PER_SEC = 1000000000LL;
+
+    int64_t toNs(const timespec& ts)
+    {
+        return static_cast<int64_t>(ts.tv_sec) * NS_PER_SEC + ts.tv_nsec;
+    }
+
+    timespec fromNs(int64_t ns)
+    {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / NS_PER_SEC);
+        ts.tv_nsec = static_cast<long>(ns % NS_PER_SEC);
+        return ts;
+    }
+}
+
+MockTickScheduler::MockTickScheduler()
+    : m_periodNs(0)
+    , m_paced(false)
+    , m_ticks(0)
+    , m_overruns(0)
+    , m_maxLatenessNs(0)
+    , m_meanLatenessNs(0.0)
+    , m_m2LatenessNs(0.0)
+{
+    m_deadline.tv_sec = 0;
+    m_deadline.tv_nsec = 0;
+}
+
+void MockTickScheduler::Configure(double tickPeriodSec, double realTimeFactor)
+{
+    m_paced = realTimeFactor > 0.0;
+    m_periodNs = m_paced ? static_cast<int64_t>(tickPeriodSec * NS_PER_SEC / realTimeFactor) : 0;
+}
+
+void MockTickScheduler::Start()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    m_deadline = fromNs(toNs(now) + m_periodNs);
+}
+
+void MockTickScheduler::WaitForNextTick()
+{
+    if (!m_paced)
+    {
+        return;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t deadlineNs = toNs(m_deadline);
+    if (toNs(now) > deadlineNs)
+    {
+        // The previous tick ran past this deadline. Count the overrun and do
+        // not sleep; where the next deadline goes is decided below.
+        m_overruns++;
+    }
+    else
+    {
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &m_deadline, nullptr) == EINTR)
+        {
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+
+    int64_t latenessNs = toNs(now) - deadlineNs;
+    m_ticks++;
+    if (latenessNs > m_maxLatenessNs)
+    {
+        m_maxLatenessNs = latenessNs;
+    }
+    double delta = latenessNs - m_meanLatenessNs;
+    m_meanLatenessNs += delta / m_ticks;
+    m_m2LatenessNs += delta * (latenessNs - m_meanLatenessNs);
+
+    // The next deadline is one period after this one, so short overruns are
+    // caught up on the same time grid. After a stall past the next deadline
+    // the missed ticks are skipped instead of burst through, and the grid is
+    // restarted one period from now.
+    int64_t nextNs = deadlineNs + m_periodNs;
+    if (toNs(now) > nextNs)
+    {
+        nextNs = toNs(now) + m_periodNs;
+    }
+    m_deadline = fromNs(nextNs);
+}
+
+void MockTickScheduler::PrintStatistics(std::ostream& out) const
+{
+    if (!m_paced || m_ticks == 0)
+    {
+        return;
+    }
+    double jitterNs = m_ticks > 1 ? std::sqrt(m_m2LatenessNs / (m_ticks - 1)) : 0.0;
+    out << "Tick pacing: ticks " << m_ticks
+        << " overruns " << m_overruns
+        << " lateness mean/max [us] " << m_meanLatenessNs / 1000.0 << "/" << m_maxLatenessNs / 1000.0
+        << " jitter [us] " << jitterNs / 1000.0 << std::endl;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ostream>
+#include <stdint.h>
+#include <time.h>
+
+// Paces the main loop on absolute CLOCK_MONOTONIC deadlines.
+// A real-time factor <= 0 runs as fast as possible, 1 follows wall clock
+// time and N runs N times faster than real time.
+class MockTickScheduler
+{
+public:
+    MockTickScheduler();
+
+    void Configure(double tickPeriodSec, double realTimeFactor);
+
+    // Sets the first deadline one period from now.
+    void Start();
+
+    // Sleeps until the next deadline and records how late the wakeup was.
+    void WaitForNextTick();
+
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    int64_t m_periodNs;
+    bool m_paced;
+    timespec m_deadline;
+
+    uint64_t m_ticks;
+    uint64_t m_overruns;       // deadlines already missed when the loop came back
+    int64_t m_maxLatenessNs;
+    double m_meanLatenessNs;   // running mean and M2 of the lateness (Welford)
+    double m_m2LatenessNs;
+};
@@ -0,0 +1,28 @@
+#include "MockTickStats.h"
+#include <fstream>
+#include <iostream>
+
+LatencyHistogram tickPhaseHistograms[TICK_PHASE_COUNT];
+std::string tickHistogramFile = "tick_latency.jsonl";
+int tickHistogramInterval = 10000;
+
+static const char* const tickPhaseNames[TICK_PHASE_COUNT] = { "write", "ack_wait", "capl", "total" };
+
+void dumpTickPhaseHistograms(int tick, const char* reason)
+{
+    std::ofstream out(tickHistogramFile.c_str(), std::ios::app);
+    if (!out)
+    {
+        std::cerr << "Cannot write tick histograms to " << tickHistogramFile << std::endl;
+        return;
+    }
+    for (int phase = 0; phase < TICK_PHASE_COUNT; ++phase)
+    {
+        out << "{\"tick\":" << tick
+            << ",\"reason\":\"" << reason << "\""
+            << ",\"phase\":\"" << tickPhaseNames[phase] << "\""
+            << ",\"unit\":\"ns\",\"histogram\":";
+        tickPhaseHistograms[phase].WriteJson(out);
+        out << "}\n";
+    }
+}
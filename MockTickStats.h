@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include "LatencyHistogram.h"
+
+// Phases of one main loop iteration that get their own latency histogram.
+enum TickPhase
+{
+    TICK_PHASE_WRITE,       // sending the step frame
+    TICK_PHASE_ACK_WAIT,    // waiting for the controller's ack
+    TICK_PHASE_CAPL,        // onstart() and the CAPL frame transaction
+    TICK_PHASE_TOTAL,       // whole iteration
+    TICK_PHASE_COUNT
+};
+
+extern LatencyHistogram tickPhaseHistograms[TICK_PHASE_COUNT];
+extern std::string tickHistogramFile;
+extern int tickHistogramInterval;   // ticks between two dumps, 0 dumps at exit only
+
+inline void recordTickPhase(TickPhase phase, int64_t startNs)
+{
+    tickPhaseHistograms[phase].Record(LatencyHistogram::Now() - startNs);
+}
+
+// Appends one JSON line per phase with the histograms collected since start.
+void dumpTickPhaseHistograms(int tick, const char* reason);
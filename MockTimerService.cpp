@@ -0,0 +1,170 @@
+#include "MockTimerService.h"
+#include <algorithm>
+
+MockTimerService::Timer::Timer(MockTimerService* service, int32_t index, VIAOnTimerSink* sink, const char* name)
+    : service(service)
+    , index(index)
+    , sink(sink)
+    , name(name != nullptr ? name : "")
+    , expiryNs(0)
+    , armSequence(0)
+    , inHeap(false)
+{
+}
+
+VIAResult MockTimerService::Timer::SetSink(VIAOnTimerSink* newSink)
+{
+    sink = newSink;
+    return kVIA_OK;
+}
+
+VIAResult MockTimerService::Timer::SetName(const char* newName)
+{
+    name = newName != nullptr ? newName : "";
+    return kVIA_OK;
+}
+
+VIAResult MockTimerService::Timer::SetTimer(VIATime nanoseconds)
+{
+    service->arm(*this, service->m_nowNs + (nanoseconds > 0 ? nanoseconds : 0));
+    return kVIA_OK;
+}
+
+VIAResult MockTimerService::Timer::CancelTimer()
+{
+    service->disarm(*this);
+    return kVIA_OK;
+}
+
+MockTimerService::MockTimerService()
+    : m_timerCount(0)
+    , m_tickPeriodNs(1)
+    , m_nowNs(0)
+    , m_windowEndNs(0)
+    , m_firing(false)
+    , m_nextArmSequence(1)
+    , m_fired(0)
+{
+}
+
+MockTimerService::~MockTimerService()
+{
+    Reset();
+}
+
+void MockTimerService::Start(int64_t tickPeriodNs)
+{
+    m_wheel.Start(tickPeriodNs);
+    m_tickPeriodNs = m_wheel.TickPeriodNs();
+    m_nowNs = 0;
+    m_windowEndNs = m_tickPeriodNs;
+}
+
+void MockTimerService::Reset()
+{
+    for (size_t i = 0; i < m_timers.size(); ++i)
+    {
+        delete m_timers[i];
+    }
+    m_timers.clear();
+    m_freeIndices.clear();
+    m_timerCount = 0;
+    m_due.clear();
+    m_wheel.Clear();
+}
+
+VIATimer* MockTimerService::Create(VIAOnTimerSink* sink, const char* name)
+{
+    int32_t index;
+    if (!m_freeIndices.empty())
+    {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        index = static_cast<int32_t>(m_timers.size());
+        m_timers.push_back(nullptr);
+        m_wheel.Reserve(m_timers.size());
+    }
+    m_timers[index] = new Timer(this, index, sink, name);
+    m_timerCount++;
+    return m_timers[index];
+}
+
+bool MockTimerService::Release(VIATimer* viaTimer)
+{
+    Timer* timer = static_cast<Timer*>(viaTimer);
+    if (timer == nullptr || timer->index < 0 || static_cast<size_t>(timer->index) >= m_timers.size() ||
+        m_timers[timer->index] != timer)
+    {
+        return false;
+    }
+    disarm(*timer);
+    m_timers[timer->index] = nullptr;
+    m_freeIndices.push_back(timer->index);
+    m_timerCount--;
+    delete timer;
+    return true;
+}
+
+void MockTimerService::arm(Timer& timer, int64_t expiryNs)
+{
+    disarm(timer);
+    timer.expiryNs = expiryNs;
+    timer.armSequence = m_nextArmSequence++;
+    if (m_firing && expiryNs < m_windowEndNs)
+    {
+        // Due in the tick that is firing right now
+        Due due = { expiryNs, timer.armSequence, timer.index };
+        m_due.push_back(due);
+        std::push_heap(m_due.begin(), m_due.end(), DueLater());
+        timer.inHeap = true;
+        return;
+    }
+    m_wheel.Schedule(timer.index, expiryNs);
+}
+
+// A timer in the heap is left there and skipped when its stale entry comes up.
+void MockTimerService::disarm(Timer& timer)
+{
+    m_wheel.Remove(timer.index);
+    timer.inHeap = false;
+}
+
+void MockTimerService::RunTick()
+{
+    for (int32_t timerIndex = m_wheel.PopDue(); timerIndex != TimingWheel::NO_ITEM; timerIndex = m_wheel.PopDue())
+    {
+        Timer& timer = *m_timers[timerIndex];
+        timer.inHeap = true;
+        Due due = { timer.expiryNs, timer.armSequence, timer.index };
+        m_due.push_back(due);
+    }
+    std::make_heap(m_due.begin(), m_due.end(), DueLater());
+
+    m_firing = true;
+    while (!m_due.empty())
+    {
+        std::pop_heap(m_due.begin(), m_due.end(), DueLater());
+        Due due = m_due.back();
+        m_due.pop_back();
+        Timer* timer = m_timers[due.index];
+        if (timer == nullptr || !timer->inHeap || timer->armSequence != due.armSequence)
+        {
+            continue;   // cancelled, re-armed or released
+        }
+        timer->inHeap = false;
+        m_nowNs = due.expiryNs > m_nowNs ? due.expiryNs : m_nowNs;
+        m_fired++;
+        if (timer->sink != nullptr)
+        {
+            timer->sink->OnTimer(due.expiryNs);
+        }
+    }
+    m_firing = false;
+
+    m_wheel.Advance();
+    m_nowNs = m_windowEndNs;
+    m_windowEndNs += m_tickPeriodNs;
+}
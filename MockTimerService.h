@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "VIA.h"
+#include "TimingWheel.h"
+
+// VIATimer objects driven by simulated time.
+//
+// Armed timers wait on a TimingWheel that counts in ticks of the step period,
+// keyed by timer index, so arming and cancelling are O(1) and a tick only
+// touches its own slot plus one slot per cascaded level, however many timers
+// are armed.
+//
+// The timers due in a tick are moved to a min-heap and fired in timestamp
+// order, timers with the same expiry in the order they were armed. A timer
+// armed from OnTimer that expires inside the same tick joins the heap and
+// fires in this tick as well. While a timer fires the simulated time is its
+// expiry; after RunTick() it is the end of the tick window.
+class MockTimerService
+{
+public:
+    MockTimerService();
+    ~MockTimerService();
+
+    void Start(int64_t tickPeriodNs);
+    // Deletes every timer, e.g. when the library that created them is gone.
+    void Reset();
+
+    VIATimer* Create(VIAOnTimerSink* sink, const char* name);
+    bool Release(VIATimer* timer);
+
+    // Fires the timers of the current tick window and advances one tick.
+    void RunTick();
+
+    int64_t Now() const { return m_nowNs; }
+    size_t TimerCount() const { return m_timerCount; }
+    uint64_t TimersFired() const { return m_fired; }
+
+private:
+    MockTimerService(const MockTimerService&);
+    MockTimerService& operator=(const MockTimerService&);
+
+    class Timer final : public VIATimer
+    {
+    public:
+        Timer(MockTimerService* service, int32_t index, VIAOnTimerSink* sink, const char* name);
+
+        VIASTDDECL SetSink(VIAOnTimerSink* sink) override;
+        VIASTDDECL SetName(const char* name) override;
+        VIASTDDECL SetTimer(VIATime nanoseconds) override;
+        VIASTDDECL CancelTimer() override;
+
+        MockTimerService* service;
+        int32_t index;
+        VIAOnTimerSink* sink;
+        std::string name;
+
+        int64_t expiryNs;
+        uint64_t armSequence;       // identifies the current arming
+        bool inHeap;
+    };
+
+    struct Due
+    {
+        int64_t expiryNs;
+        uint64_t armSequence;
+        int32_t index;
+    };
+
+    struct DueLater
+    {
+        bool operator()(const Due& a, const Due& b) const
+        {
+            return a.expiryNs != b.expiryNs ? a.expiryNs > b.expiryNs : a.armSequence > b.armSequence;
+        }
+    };
+
+    void arm(Timer& timer, int64_t expiryNs);
+    void disarm(Timer& timer);
+
+    std::vector<Timer*> m_timers;       // by index, null when free
+    std::vector<int32_t> m_freeIndices;
+    size_t m_timerCount;
+
+    TimingWheel m_wheel;
+    std::vector<Due> m_due;             // heap of the current tick
+
+    int64_t m_tickPeriodNs;
+    int64_t m_nowNs;
+    int64_t m_windowEndNs;
+    bool m_firing;
+    uint64_t m_nextArmSequence;
+    uint64_t m_fired;
+};
@@ -0,0 +1,102 @@
+#include "MockViaService.h"
+#include "AsyncLogger.h"
+
+VIAResult MockViaService::GetVersion(int32* major, int32* minor, int32* patchlevel)
+{
+    *major = VIAMajorVersion;
+    *minor = VIAMinorVersion;
+    *patchlevel = 0;
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::CreateTimer(VIATimer** timer, VIANode* node, VIAOnTimerSink* sink, const char* name)
+{
+    if (timer == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    *timer = m_timers.Create(sink, name);
+    LOG_DEBUG(LOG_CAT_CAPL, "Mock: Created timer %s", name != nullptr ? name : "");
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::ReleaseTimer(VIATimer* timer)
+{
+    return m_timers.Release(timer) ? kVIA_OK : kVIA_ObjectInvalid;
+}
+
+// Only CAN is mocked. The interface version asked for is not checked, the
+// DLL reads it back through VIABus::GetVersion.
+VIAResult MockViaService::GetBusInterface(VIABus** busInterface, VIANode* node, uint32 interfaceType, int32 majorversion,
+                                          int32 minorversion)
+{
+    if (busInterface == nullptr)
+    {
+        return kVIA_ParameterInvalid;
+    }
+    *busInterface = nullptr;
+    if (interfaceType != kVIA_CAN)
+    {
+        return kVIA_MissingInterface;
+    }
+    *busInterface = &m_canBus;
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::ReleaseBusInterface(VIABus* busInterface)
+{
+    return busInterface == &m_canBus ? kVIA_OK : kVIA_ObjectInvalid;
+}
+
+VIAResult MockViaService::GetCurrentNode(VIANode** node)
+{
+    *node = &m_node;
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::WriteString(const char* text)
+{
+    LOG_INFO(LOG_CAT_CAPL, "%s", text != nullptr ? text : "");
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::WriteToLog(const char* text)
+{
+    LOG_INFO(LOG_CAT_CAPL, "%s", text != nullptr ? text : "");
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::GetCurrentSimTime(VIATime* time)
+{
+    *time = m_timers.Now();
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::IsSimulated(int32* simulated)
+{
+    *simulated = 1;
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::GetSystemVariablesRootNamespace(VIANamespace*& nameSpace)
+{
+    nameSpace = m_sysVars.Root();
+    return kVIA_OK;
+}
+
+// Clients only tell owners of read-only variables apart, any handle will do.
+VIAResult MockViaService::RegisterSystemVariablesClient(VIASysVarClientHandle handle, const char* description)
+{
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::UnregisterSystemVariablesClient(VIASysVarClientHandle handle)
+{
+    return kVIA_OK;
+}
+
+VIAResult MockViaService::GetSystemVariablesDefaultClientHandle(VIASysVarClientHandle* handle, VIAModuleApi* module)
+{
+    *handle = this;
+    return kVIA_OK;
+}
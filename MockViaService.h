@@ -0,0 +1,116 @@
+#pragma once
+
+#include "VIA.h"
+#include "MockTimerService.h"
+#include "MockSysVarStore.h"
+#include "MockCanBus.h"
+#include "MockCaplNode.h"
+
+// VIAService handed to a CAPL DLL through its VIASetService export.
+//
+// Timers run on simulated time (see MockTimerService), system variables
+// live in a MockSysVarStore and the node sits on a MockCanBus; the rest of
+// the service is what a DLL typically probes at start-up: version, output
+// and simulation time. Everything else reports kVIA_FunctionNotImplemented.
+class MockViaService : public VIAService {
+public:
+    MockTimerService& Timers() { return m_timers; }
+    const MockTimerService& Timers() const { return m_timers; }
+    MockSysVarStore& SysVars() { return m_sysVars; }
+    const MockSysVarStore& SysVars() const { return m_sysVars; }
+    MockCanBus& CanBus() { return m_canBus; }
+    const MockCanBus& CanBus() const { return m_canBus; }
+    MockCaplNode& Node() { return m_node; }
+
+    VIASTDDECL GetVersion(int32* major, int32* minor, int32* patchlevel) override;
+    VIASTDDECL GetClientWindow(void** handle) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetConfigItem(uint32 topic, uint32 subtopic, char* buffer, int32 bufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBAttributeType(uint32* attributeType, uint32 objectType, const char* objectName, const char* attrName, const char* dbName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBAttributeValue(double* attributeValue, uint32 objectType, const char* objectName, const char* attrName, const char* dbName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDBAttributeString(char* buffer, int32 bufferLength, uint32 objectType, const char* objectName, const char* attrName, const char* dbName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL CreateTimer(VIATimer** timer, VIANode* node, VIAOnTimerSink* sink, const char* name) override;
+    VIASTDDECL ReleaseTimer(VIATimer* timer) override;
+    VIASTDDECL GetEnvVar(VIAEnvVar** ev, VIANode* node, const char* name, VIAOnEnvVar* sink) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseEnvVar(VIAEnvVar* ev) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetBusInterface(VIABus** busInterface, VIANode* node, uint32 interfaceType, int32 majorversion, int32 minorversion) override;
+    VIASTDDECL ReleaseBusInterface(VIABus* busInterface) override;
+    VIASTDDECL GetUtilService(VIAUtil** service, int32 majorversion, int32 minorversion) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseUtilService(VIAUtil* service) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL WriteString(const char* text) override;
+    VIASTDDECL WriteToLog(const char* text) override;
+    VIASTDDECL Assertion(char* message, char* condition, char* file, int32 line) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL MsgBox(char* message) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL RtKernelIsRunning() override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetCurrentNode(VIANode** node) override;
+    VIASTDDECL GetCurrentNodeLayer(VIANodeLayerApi** nodelayer, VIAModuleApi* module) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetCurrentSimTime(VIATime* time) override;
+    VIASTDDECL Stop() override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSystemFiber(void** fiber) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetServiceFlags(uint32* flags) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL CreateWriteTab(uint32* aSink, const char* aSinkName) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseWriteTab(uint32 aSink) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL WriteStringToTab(uint32 aSink, VIAWriteSeverity aSeverity, const char* aText) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetTestControlApi(VIATestControlApi** apTestControlObject, VIANode* node) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseTestControlApi(VIATestControlApi* apTestControlObject) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ClearWriteTab(uint32 aSink) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL SetNLServiceApi(VIANLServiceApi* apNLServiceMember, VIANode* apMyNode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ProvideNLService(int8 aMultiUserService, VIANLService* apServiceToProvide, VIANode* apMyNode, VIANLServiceApi* apNLServiceProvider) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL AcquireNLService(const char* apServiceName, int32 aInterfaceVersion, VIANLService** appService, VIANode* apMyNode, VIANLServiceApi* apNLServiceUser) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL CancelNLService(VIANLService* apServiceToCancel, VIANode* apMyNode, VIANLServiceApi* apNLServiceProvider) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseNLService(VIANLService* apServiceToRelease, VIANode* apMyNode, VIANLServiceApi* apNLServiceUser) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSignalAccessApi(VIASignalAccessApi** aSignalAccessApi, VIANode* aNode, int32 majorversion, int32 minorversion) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSystemVariablesRootNamespace(VIANamespace*& nameSpace) override;
+    VIASTDDECL RegisterSystemVariablesClient(VIASysVarClientHandle handle, const char* description) override;
+    VIASTDDECL UnregisterSystemVariablesClient(VIASysVarClientHandle handle) override;
+    VIASTDDECL GetDatabaseIterator(VIDBDatabaseIterator** iterator) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL DebugBreak() override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL IsSimulated(int32* simulated) override;
+    VIASTDDECL GetSocketService(VIASocketService** ppService, VIANode* pNode, VIASocketServiceType type) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseSocketService(VIASocketService* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL NotifyDiagnosticEvent(VIAProtocolType type, void* params, int32 request, int8 buffer[], uint32 size) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDiagDescription(const char* aEcuQualifier_in, char* apEcuId_out, int32 aLenEcuId, char* apVariantQualifier_out, int32 aLenVariantQualifier, char* apLanguage_out, int32 aLenLanguage, char* apPath_out, int32 aLenPath) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSerialService(VIASerialService** ppService, VIANode* pNode, VIASerialServiceType type) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseSerialService(VIASerialService* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetUserFilePath(const char* filename, char* pathBuffer, int32 pathBufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSystemVariablesDefaultClientHandle(VIASysVarClientHandle* handle, VIAModuleApi* module) override;
+    VIASTDDECL RegisterUserFile(const char* filePath, bool isTempRegistration) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL IncrementTimerBase(VIATime newTimeBaseTicks, int32 numberOfTicks) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL IsSlaveMode(bool* isSlaveMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetCAPLonBoardConstruction(VIACAPLonBoardConstruction** cob) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseCAPLonBoardConstruction(VIACAPLonBoardConstruction* cob) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetTestApi(VIATestApi** apTestApi, VIANode* pNode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseTestApi(VIATestApi* apTestApi) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSocketServiceEx(VIASocketServiceEx** ppService, VIANode* pNode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseSocketServiceEx(VIASocketServiceEx* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetParameterServerService(VIAParameterServerService** pVIAParameterServerService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL SetNLServiceApi2(VIANLServiceApi* apNLServiceMember, VIANode* apMyNode, VIANLServiceExecutionMode execMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ProvideNLService2(int8 aMultiUserService, VIANLService* apServiceToProvide, VIANode* apMyNode, VIANLServiceApi* apNLServiceProvider, VIANLServiceExecutionMode execMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL AcquireNLService2(const char* apServiceName, int32 aInterfaceVersion, VIANLService** appService, VIANode* apMyNode, VIANLServiceApi* apNLServiceUser, VIANLServiceExecutionMode execMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL CancelNLService2(VIANLService* apServiceToCancel, VIANode* apMyNode, VIANLServiceApi* apNLServiceProvider, VIANLServiceExecutionMode execMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseNLService2(VIANLService* apServiceToRelease, VIANode* apMyNode, VIANLServiceApi* apNLServiceUser, VIANLServiceExecutionMode execMode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSynchronizedFilePath(const char* filename, char* pathBuffer, uint32 pathBufferLength) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetMediaService(VIAMediaService** ppService, VIANode* pNode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseMediaService(VIAMediaService* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetCurrentClient(void** pClient) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetClient(VIANode* pNode, void** pClient) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL SetCurrentClient(void* pClient) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetBusContext(VIANode* pNode, uint32* channelType, uint32* channelNumber) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL SetBusContext(VIANode* pNode, uint32 channelType, uint32 channelNumber) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetFunctionBusService(VIAFbViaService** outFbViaService, int32 majorversion, int32 minorversion) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseFunctionBusService(VIAFbViaService* inFbViaService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL RegisterCoreProcessingFunction(ICoreProcessingFunction* fct, bool once, uint32* handle) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL UnregisterCoreProcessingFunction(uint32 handle) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSocketService2(VIASocketService2** ppService, VIANode* pNode, VIASocketServiceType type) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseSocketService2(VIASocketService2* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetSocketServiceEx2(VIASocketServiceEx2** ppService, VIANode* pNode) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL ReleaseSocketServiceEx2(VIASocketServiceEx2* pService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetFBDataModelIterator(VIDBDatabaseIterator** iterator) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL GetDebugInfoService(VIADebugInfoService** ppService) override { return kVIA_FunctionNotImplemented; }
+    VIASTDDECL IsValidLicense(uint32 productCode, uint32 productVersionMajor, uint32 productVersionMinor) override { return kVIA_FunctionNotImplemented; }
+
+private:
+    MockTimerService m_timers;
+    MockSysVarStore m_sysVars;
+    MockCanBus m_canBus;
+    MockCaplNode m_node;
+};
@@ -0,0 +1,228 @@
+#include "PcapReplay.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    const uint32_t PCAP_MAGIC_US = 0xA1B2C3D4u;
+    const uint32_t PCAP_MAGIC_NS = 0xA1B23C4Du;
+    const uint32_t PCAP_LINKTYPE_ETHERNET = 1;
+
+    struct PcapFileHeader
+    {
+        uint32_t magic;
+        uint16_t versionMajor;
+        uint16_t versionMinor;
+        int32_t thiszone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+    };
+
+    struct PcapRecordHeader
+    {
+        uint32_t seconds;
+        uint32_t fraction;          // microseconds or nanoseconds
+        uint32_t includedLength;
+        uint32_t originalLength;
+    };
+
+    uint32_t swap32(uint32_t value)
+    {
+        return (value >> 24) | ((value >> 8) & 0xFF00u) | ((value << 8) & 0xFF0000u) | (value << 24);
+    }
+}
+
+PcapReplay::PcapReplay()
+    : m_fd(-1)
+    , m_buffer(nullptr)
+    , m_bufferBegin(0)
+    , m_bufferEnd(0)
+    , m_swapped(false)
+    , m_nanoseconds(false)
+    , m_channel(1)
+    , m_hasHeader(false)
+    , m_nextTimestampNs(0)
+    , m_nextLength(0)
+    , m_firstTimestampNs(-1)
+    , m_atEnd(true)
+    , m_framesRead(0)
+    , m_framesTruncated(0)
+{
+}
+
+PcapReplay::~PcapReplay()
+{
+    Close();
+}
+
+bool PcapReplay::Open(const std::string& path, uint32_t channel)
+{
+    Close();
+    m_errorDescription.clear();
+
+    m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+    if (m_fd < 0)
+    {
+        m_errorDescription = std::string("Cannot open pcap ").append(path).append(": ").append(strerror(errno));
+        return false;
+    }
+    m_buffer = new unsigned char[READ_BUFFER_SIZE];
+    m_bufferBegin = 0;
+    m_bufferEnd = 0;
+    m_channel = channel;
+    m_firstTimestampNs = -1;
+    m_framesRead = 0;
+    m_framesTruncated = 0;
+
+    PcapFileHeader header;
+    if (!read(&header, sizeof(header)))
+    {
+        m_errorDescription = path + " is not a pcap file";
+        Close();
+        return false;
+    }
+    m_swapped = header.magic == swap32(PCAP_MAGIC_US) || header.magic == swap32(PCAP_MAGIC_NS);
+    uint32_t magic = field(header.magic);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS)
+    {
+        m_errorDescription = path + " is not a pcap file (pcapng is not supported)";
+        Close();
+        return false;
+    }
+    if (field(header.linktype) != PCAP_LINKTYPE_ETHERNET)
+    {
+        m_errorDescription = path + " does not contain Ethernet frames";
+        Close();
+        return false;
+    }
+    m_nanoseconds = magic == PCAP_MAGIC_NS;
+    m_atEnd = !readHeader();
+    return true;
+}
+
+void PcapReplay::Close()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    delete[] m_buffer;
+    m_buffer = nullptr;
+    m_hasHeader = false;
+    m_atEnd = true;
+}
+
+uint32_t PcapReplay::field(uint32_t value) const
+{
+    return m_swapped ? swap32(value) : value;
+}
+
+// Copies size bytes of the file into data, refilling the buffer as needed.
+// Large reads with an empty buffer go straight into data.
+bool PcapReplay::read(void* data, size_t size)
+{
+    unsigned char* out = static_cast<unsigned char*>(data);
+    while (size > 0)
+    {
+        if (m_bufferBegin == m_bufferEnd)
+        {
+            unsigned char* target = size >= READ_BUFFER_SIZE ? out : m_buffer;
+            ssize_t got = ::read(m_fd, target, size >= READ_BUFFER_SIZE ? size : READ_BUFFER_SIZE);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                return false;
+            }
+            if (target == out)
+            {
+                out += got;
+                size -= static_cast<size_t>(got);
+                continue;
+            }
+            m_bufferBegin = 0;
+            m_bufferEnd = static_cast<size_t>(got);
+        }
+        size_t chunk = size < m_bufferEnd - m_bufferBegin ? size : m_bufferEnd - m_bufferBegin;
+        memcpy(out, m_buffer + m_bufferBegin, chunk);
+        m_bufferBegin += chunk;
+        out += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool PcapReplay::skip(size_t size)
+{
+    unsigned char scratch[256];
+    while (size > 0)
+    {
+        size_t chunk = size < sizeof(scratch) ? size : sizeof(scratch);
+        if (!read(scratch, chunk))
+        {
+            return false;
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+bool PcapReplay::readHeader()
+{
+    PcapRecordHeader record;
+    m_hasHeader = read(&record, sizeof(record));
+    if (!m_hasHeader)
+    {
+        return false;
+    }
+    int64_t fraction = field(record.fraction);
+    int64_t timestampNs = static_cast<int64_t>(field(record.seconds)) * 1000000000LL + (m_nanoseconds ? fraction : fraction * 1000);
+    if (m_firstTimestampNs < 0)
+    {
+        m_firstTimestampNs = timestampNs;
+    }
+    m_nextTimestampNs = timestampNs - m_firstTimestampNs;
+    m_nextLength = field(record.includedLength);
+    return true;
+}
+
+size_t PcapReplay::CollectUntil(int64_t windowEndNs, EthFramePool& pool, std::vector<EthFrame*>& frames)
+{
+    size_t added = 0;
+    while (m_hasHeader && m_nextTimestampNs < windowEndNs)
+    {
+        EthFrame* frame = pool.Acquire();
+        if (frame == nullptr)
+        {
+            break;      // retried next tick
+        }
+        uint32_t length = m_nextLength < ETH_MAX_PAYLOAD ? m_nextLength : ETH_MAX_PAYLOAD;
+        frame->timestamp_ns = m_nextTimestampNs;
+        frame->channel = m_channel;
+        frame->direction = 0;
+        frame->reserved = 0;
+        frame->length = static_cast<uint16_t>(length);
+        if (!read(frame->Data(), length) || !skip(m_nextLength - length))
+        {
+            EthFramePool::Release(frame);
+            m_hasHeader = false;
+            break;
+        }
+        if (length < m_nextLength)
+        {
+            m_framesTruncated++;
+        }
+        m_framesRead++;
+        frames.push_back(frame);
+        ++added;
+        readHeader();
+    }
+    m_atEnd = !m_hasHeader;
+    return added;
+}
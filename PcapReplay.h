@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MockMessages.h"
+#include "EthFramePool.h"
+
+// Replays the Ethernet frames of a classic pcap capture (link type
+// Ethernet, microsecond or nanosecond timestamps, either byte order).
+//
+// Packets are read through a small buffer straight into EthFramePool
+// buffers and handed out one tick window at a time; the first packet is at
+// trace time 0. When the pool is exhausted the next packet waits for a later
+// tick instead of being dropped. Packets longer than ETH_MAX_PAYLOAD are
+// truncated.
+class PcapReplay
+{
+public:
+    static const size_t READ_BUFFER_SIZE = 256 * 1024;
+
+    PcapReplay();
+    ~PcapReplay();
+
+    bool Open(const std::string& path, uint32_t channel);
+    void Close();
+
+    bool IsOpen() const { return m_fd >= 0; }
+    bool AtEnd() const { return m_atEnd; }
+
+    // Appends every frame stamped before windowEndNs to frames, each with one
+    // reference owned by the caller. Returns how many were added.
+    size_t CollectUntil(int64_t windowEndNs, EthFramePool& pool, std::vector<EthFrame*>& frames);
+
+    uint64_t FramesRead() const { return m_framesRead; }
+    uint64_t FramesTruncated() const { return m_framesTruncated; }
+    std::string getErrorDescription() const { return m_errorDescription; }
+
+private:
+    PcapReplay(const PcapReplay&);
+    PcapReplay& operator=(const PcapReplay&);
+
+    bool readHeader();
+    bool read(void* data, size_t size);
+    bool skip(size_t size);
+    uint32_t field(uint32_t value) const;
+
+    int m_fd;
+    unsigned char* m_buffer;
+    size_t m_bufferBegin;
+    size_t m_bufferEnd;
+
+    bool m_swapped;
+    bool m_nanoseconds;
+    uint32_t m_channel;
+
+    // Record header of the next packet, read ahead of its window
+    bool m_hasHeader;
+    int64_t m_nextTimestampNs;
+    uint32_t m_nextLength;
+    int64_t m_firstTimestampNs;
+    bool m_atEnd;
+
+    uint64_t m_framesRead;
+    uint64_t m_framesTruncated;
+    std::string m_errorDescription;
+};
@@ -0,0 +1,138 @@
+#include "TimingWheel.h"
+#include <algorithm>
+
+const int32_t TimingWheel::NO_ITEM;
+
+TimingWheel::TimingWheel()
+    : m_tickPeriodNs(1)
+    , m_tick(0)
+{
+    std::fill(m_slots, m_slots + SLOT_COUNT, NO_ITEM);
+}
+
+void TimingWheel::Start(int64_t tickPeriodNs)
+{
+    m_tickPeriodNs = tickPeriodNs > 0 ? tickPeriodNs : 1;
+    m_tick = 0;
+    Clear();
+}
+
+void TimingWheel::Clear()
+{
+    std::fill(m_slots, m_slots + SLOT_COUNT, NO_ITEM);
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        m_links[i].slot = NO_ITEM;
+    }
+}
+
+void TimingWheel::Reserve(size_t count)
+{
+    if (count > m_links.size())
+    {
+        Link unscheduled = { 0, NO_ITEM, NO_ITEM, NO_ITEM };
+        m_links.resize(count, unscheduled);
+    }
+}
+
+void TimingWheel::Schedule(int32_t item, int64_t expiryNs)
+{
+    uint64_t due = expiryNs > 0 ? static_cast<uint64_t>(expiryNs / m_tickPeriodNs) : 0;
+    m_links[item].dueTick = std::max(due, m_tick);
+    place(item);
+}
+
+void TimingWheel::place(int32_t item)
+{
+    Link& link = m_links[item];
+    uint64_t due = link.dueTick < m_tick ? m_tick : link.dueTick;
+    uint64_t delta = due - m_tick;
+
+    int level = 0;
+    int index = static_cast<int>(due & (LEVEL0_SIZE - 1));
+    int shift = LEVEL0_BITS;
+    while (delta >= (1ull << shift) && level < LEVELS - 1)
+    {
+        ++level;
+        if (level == LEVELS - 1 && delta >= (1ull << (shift + LEVEL_BITS)))
+        {
+            // Beyond the wheel, parked in the last slot and re-cascaded
+            due = m_tick + (1ull << (shift + LEVEL_BITS)) - 1;
+        }
+        index = static_cast<int>((due >> shift) & (LEVEL_SIZE - 1));
+        shift += LEVEL_BITS;
+    }
+
+    int32_t slot = level == 0 ? index : LEVEL0_SIZE + (level - 1) * LEVEL_SIZE + index;
+    link.slot = slot;
+    link.prev = NO_ITEM;
+    link.next = m_slots[slot];
+    if (link.next != NO_ITEM)
+    {
+        m_links[link.next].prev = item;
+    }
+    m_slots[slot] = item;
+}
+
+void TimingWheel::Remove(int32_t item)
+{
+    Link& link = m_links[item];
+    if (link.slot == NO_ITEM)
+    {
+        return;
+    }
+    if (link.prev != NO_ITEM)
+    {
+        m_links[link.prev].next = link.next;
+    }
+    else
+    {
+        m_slots[link.slot] = link.next;
+    }
+    if (link.next != NO_ITEM)
+    {
+        m_links[link.next].prev = link.prev;
+    }
+    link.slot = NO_ITEM;
+    link.prev = NO_ITEM;
+    link.next = NO_ITEM;
+}
+
+int32_t TimingWheel::PopDue()
+{
+    int32_t item = m_slots[m_tick & (LEVEL0_SIZE - 1)];
+    if (item != NO_ITEM)
+    {
+        Remove(item);
+    }
+    return item;
+}
+
+// Moves the slot of level that comes up at the current tick one level down
+// and returns its index, 0 means the next level has to cascade as well.
+int TimingWheel::cascade(int level)
+{
+    int shift = LEVEL0_BITS + (level - 1) * LEVEL_BITS;
+    int index = static_cast<int>((m_tick >> shift) & (LEVEL_SIZE - 1));
+    int32_t& head = m_slots[LEVEL0_SIZE + (level - 1) * LEVEL_SIZE + index];
+    int32_t item = head;
+    head = NO_ITEM;
+    while (item != NO_ITEM)
+    {
+        int32_t next = m_links[item].next;
+        place(item);
+        item = next;
+    }
+    return index;
+}
+
+void TimingWheel::Advance()
+{
+    m_tick++;
+    if ((m_tick & (LEVEL0_SIZE - 1)) == 0)
+    {
+        for (int level = 1; level < LEVELS && cascade(level) == 0; ++level)
+        {
+        }
+    }
+}
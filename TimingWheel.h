@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Hierarchical timing wheel counting in ticks of the step period.
+//
+// Level 0 holds the next 256 ticks, every further level 64 slots of the
+// level below; an item further out than the wheel reaches is parked in the
+// last slot and cascaded again. Items are identified by index and chained in
+// doubly linked slot lists, so scheduling and removing are O(1) and a tick
+// only touches its own slot plus one slot per cascaded level, however many
+// items are scheduled. The owner keeps the items themselves, the wheel only
+// stores their due tick and links.
+class TimingWheel
+{
+public:
+    static const int32_t NO_ITEM = -1;
+
+    TimingWheel();
+
+    // Empties the wheel and restarts at tick 0.
+    void Start(int64_t tickPeriodNs);
+    // Removes every item, the current tick is kept.
+    void Clear();
+    // Makes room for the items 0 .. count - 1.
+    void Reserve(size_t count);
+
+    // Places item in the slot of the tick expiryNs falls into, an expiry in
+    // the past is due in the current tick. The item must not be scheduled.
+    void Schedule(int32_t item, int64_t expiryNs);
+    void Remove(int32_t item);
+    bool Contains(int32_t item) const { return m_links[item].slot != NO_ITEM; }
+
+    // Takes one item due in the current tick, NO_ITEM when there is none left.
+    int32_t PopDue();
+    // Moves to the next tick and cascades the levels whose slot comes up.
+    void Advance();
+
+    uint64_t Tick() const { return m_tick; }
+    int64_t TickPeriodNs() const { return m_tickPeriodNs; }
+
+private:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4;
+    static const int LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const int SLOT_COUNT = LEVEL0_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+
+    struct Link
+    {
+        uint64_t dueTick;
+        int32_t slot;               // NO_ITEM while not scheduled
+        int32_t prev;
+        int32_t next;
+    };
+
+    void place(int32_t item);
+    int cascade(int level);
+
+    std::vector<Link> m_links;      // by item
+    int32_t m_slots[SLOT_COUNT];    // level 0 first, then LEVEL_SIZE slots per level
+    int64_t m_tickPeriodNs;
+    uint64_t m_tick;
+};
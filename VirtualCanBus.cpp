@@ -0,0 +1,110 @@
+#include "VirtualCanBus.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint8_t DIRECTION_RX = 0;
+    const uint8_t DIRECTION_TX = 1;
+}
+
+const size_t VirtualCanBus::QUEUE_CAPACITY;
+const uint64_t VirtualCanBus::SEQUENCE_MASK;
+
+VirtualCanBus::VirtualCanBus()
+    : m_delivery(QUEUE_CAPACITY)
+    , m_tickPeriodNs(0)
+    , m_nowNs(0)
+    , m_arbitrated(0)
+    , m_busiestTick(0)
+{
+}
+
+void VirtualCanBus::Start(int64_t tickPeriodNs)
+{
+    m_tickPeriodNs = tickPeriodNs;
+    m_nowNs = 0;
+}
+
+int VirtualCanBus::AddNode()
+{
+    m_nodes.push_back(std::unique_ptr<Node>(new Node()));
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void VirtualCanBus::Transmit(int node, const CanFrame& frame)
+{
+    m_nodes[node]->queue.Append(frame);
+    m_nodes[node]->transmitted++;
+}
+
+// The 32 bits a frame sends during arbitration, left aligned so that the
+// lower value wins: base ID, RTR (SRR for extended frames), IDE, then the
+// extended ID and its RTR. A standard frame thus beats an extended frame
+// with the same base ID.
+uint32_t VirtualCanBus::arbitrationField(const CanFrame& frame)
+{
+    uint32_t rtr = frame.rtr ? 1u : 0u;
+    if (frame.id & CAN_EXTENDED_ID_FLAG)
+    {
+        uint32_t id = frame.id & 0x1FFFFFFFu;
+        return ((id >> 18) << 21) | (1u << 20) | (1u << 19) | ((id & 0x3FFFFu) << 1) | rtr;
+    }
+    return ((frame.id & 0x7FFu) << 21) | (rtr << 20);
+}
+
+void VirtualCanBus::Arbitrate()
+{
+    m_pending.clear();
+    uint64_t sequence = 0;
+    for (size_t node = 0; node < m_nodes.size(); ++node)
+    {
+        const CanFrameArena& queue = m_nodes[node]->queue;
+        const CanFrame* frame = queue.First();
+        for (size_t i = 0; i < queue.Count(); ++i, frame = CanFrameNext(frame), ++sequence)
+        {
+            Pending pending;
+            pending.key = (static_cast<uint64_t>(frame->channel) << 56) |
+                          (static_cast<uint64_t>(arbitrationField(*frame)) << 24) | (sequence & SEQUENCE_MASK);
+            pending.frame = frame;
+            pending.sender = static_cast<int32_t>(node);
+            m_pending.push_back(pending);
+        }
+    }
+    std::sort(m_pending.begin(), m_pending.end());
+
+    // Frames sent in this tick reach the nodes at the start of the next one
+    m_nowNs += m_tickPeriodNs;
+    m_delivery.Reset();
+    m_senders.clear();
+    for (size_t i = 0; i < m_pending.size(); ++i)
+    {
+        const CanFrame& frame = *m_pending[i].frame;
+        CanFrame* copy = m_delivery.Append(frame.length);
+        std::memcpy(copy, &frame, sizeof(CanFrame) + copy->length);
+        copy->timestamp_ns = m_nowNs;
+        copy->direction = DIRECTION_RX;
+        m_senders.push_back(m_pending[i].sender);
+    }
+    m_arbitrated += m_pending.size();
+    m_busiestTick = std::max(m_busiestTick, m_pending.size());
+
+    for (size_t node = 0; node < m_nodes.size(); ++node)
+    {
+        m_nodes[node]->queue.Reset();
+    }
+}
+
+void VirtualCanBus::Collect(int node, CanFrameArena& frames) const
+{
+    const CanFrame* frame = m_delivery.First();
+    for (size_t i = 0; i < m_delivery.Count(); ++i, frame = CanFrameNext(frame))
+    {
+        CanFrame* copy = frames.Append(frame->length);
+        std::memcpy(copy, frame, sizeof(CanFrame) + copy->length);
+        if (m_senders[i] == node)
+        {
+            copy->direction = DIRECTION_TX;
+        }
+    }
+}
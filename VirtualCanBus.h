@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "CanFrameArena.h"
+
+// CAN bus shared by the CAPL instances of one run.
+//
+// Every node queues the frames its DLL transmits during a tick in a queue of
+// its own, so nodes stepped on different threads never touch shared state.
+// Once all nodes are done, Arbitrate() orders the frames of each channel the
+// way bus arbitration would, by the identifier bits as they go out on the
+// wire, and packs them into one delivery batch. In the next tick every node
+// appends that batch to the frames it injects: frames of other nodes as Rx,
+// its own frames as the Tx echo.
+//
+// Queues, batch and the arbitration order are reused from tick to tick and
+// only grow when a tick carries more frames than any before.
+class VirtualCanBus
+{
+public:
+    VirtualCanBus();
+
+    void Start(int64_t tickPeriodNs);
+    // Returns the id of the new node.
+    int AddNode();
+
+    // Queues a frame transmitted by node, called on the node's thread.
+    void Transmit(int node, const CanFrame& frame);
+    // Appends the frames arbitrated at the end of the previous tick.
+    void Collect(int node, CanFrameArena& frames) const;
+    // Moves the frames queued in this tick into the delivery batch. Called
+    // on one thread while no node is stepped.
+    void Arbitrate();
+
+    size_t NodeCount() const { return m_nodes.size(); }
+    uint64_t FramesTransmitted(int node) const { return m_nodes[node]->transmitted; }
+    uint64_t FramesArbitrated() const { return m_arbitrated; }
+    size_t BusiestTick() const { return m_busiestTick; }
+
+private:
+    VirtualCanBus(const VirtualCanBus&);
+    VirtualCanBus& operator=(const VirtualCanBus&);
+
+    static const size_t QUEUE_CAPACITY = 64 * 1024;
+    static const uint64_t SEQUENCE_MASK = (1ull << 24) - 1;
+
+    struct Node
+    {
+        Node() : queue(QUEUE_CAPACITY), transmitted(0) {}
+
+        CanFrameArena queue;
+        uint64_t transmitted;
+        char padding[64];           // keeps the queues of nodes on different threads off each other's cache lines
+    };
+
+    // Sorted by key: channel, arbitration field, queue order.
+    struct Pending
+    {
+        uint64_t key;
+        const CanFrame* frame;
+        int32_t sender;
+
+        bool operator<(const Pending& other) const { return key < other.key; }
+    };
+
+    static uint32_t arbitrationField(const CanFrame& frame);
+
+    std::vector<std::unique_ptr<Node> > m_nodes;
+    std::vector<Pending> m_pending;
+    CanFrameArena m_delivery;
+    std::vector<int32_t> m_senders;     // sender of each frame in m_delivery
+    int64_t m_tickPeriodNs;
+    int64_t m_nowNs;
+    uint64_t m_arbitrated;
+    size_t m_busiestTick;
+};
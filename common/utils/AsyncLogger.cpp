@@ -0,0 +1,174 @@
+#include "AsyncLogger.h"
+#include <stdarg.h>
+#include <time.h>
+#include <chrono>
+
+namespace
+{
+    const char* const levelNames[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+    const char* const categoryNames[LOG_CAT_COUNT] = { "main", "tick", "ipc", "capl" };
+
+    // Pause of the writer thread when the ring is empty.
+    const int LOG_IDLE_SLEEP_US = 1000;
+
+    int64_t monotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+}
+
+AsyncLogger& AsyncLogger::Instance()
+{
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : m_slots(new Slot[SLOT_COUNT])
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_writtenPos(0)
+    , m_dropped(0)
+    , m_categoryMask((1u << LOG_CAT_COUNT) - 1)
+    , m_running(true)
+    , m_startNs(monotonicNs())
+{
+    for (int i = 0; i < SLOT_COUNT; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_writer = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    m_running.store(false, std::memory_order_release);
+    if (m_writer.joinable())
+    {
+        m_writer.join();
+    }
+    delete[] m_slots;
+}
+
+void AsyncLogger::SetCategoryEnabled(LogCategory category, bool enabled)
+{
+    if (enabled)
+    {
+        m_categoryMask.fetch_or(1u << category);
+    }
+    else
+    {
+        m_categoryMask.fetch_and(~(1u << category));
+    }
+}
+
+void AsyncLogger::Log(int level, LogCategory category, const char* format, ...)
+{
+    // Bounded MPSC queue: a slot is free for position pos when its sequence
+    // equals pos, and readable by the writer when it equals pos + 1.
+    uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true)
+    {
+        slot = &m_slots[pos & (SLOT_COUNT - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - pos);
+        if (diff == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestampNs = monotonicNs();
+    slot->level = static_cast<uint8_t>(level);
+    slot->category = static_cast<uint8_t>(category);
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(slot->message, MESSAGE_SIZE, format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        length = 0;
+    }
+    slot->length = static_cast<uint16_t>(length < MESSAGE_SIZE ? length : MESSAGE_SIZE - 1);
+
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool AsyncLogger::writePending()
+{
+    bool wroteOut = false, wroteErr = false;
+    while (true)
+    {
+        Slot& slot = m_slots[m_dequeuePos & (SLOT_COUNT - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+        {
+            break;
+        }
+
+        int64_t elapsedUs = (slot.timestampNs - m_startNs) / 1000;
+        int level = slot.level < LOG_LEVEL_OFF ? slot.level : LOG_LEVEL_ERROR;
+        FILE* out = level >= LOG_LEVEL_WARN ? stderr : stdout;
+        fprintf(out, "[%6lld.%06lld] %s %-4s %.*s\n",
+            (long long)(elapsedUs / 1000000), (long long)(elapsedUs % 1000000),
+            levelNames[level], categoryNames[slot.category], (int)slot.length, slot.message);
+        (out == stderr ? wroteErr : wroteOut) = true;
+
+        slot.sequence.store(m_dequeuePos + SLOT_COUNT, std::memory_order_release);
+        ++m_dequeuePos;
+    }
+
+    uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+        fprintf(stderr, "[logger] %llu messages dropped, ring full\n", (unsigned long long)dropped);
+        wroteErr = true;
+    }
+    if (wroteOut)
+    {
+        fflush(stdout);
+    }
+    if (wroteErr)
+    {
+        fflush(stderr);
+    }
+    m_writtenPos.store(m_dequeuePos, std::memory_order_release);
+    return wroteOut || wroteErr;
+}
+
+void AsyncLogger::run()
+{
+    while (m_running.load(std::memory_order_acquire))
+    {
+        if (!writePending())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(LOG_IDLE_SLEEP_US));
+        }
+    }
+    writePending();
+}
+
+void AsyncLogger::Flush()
+{
+    uint64_t target = m_enqueuePos.load(std::memory_order_acquire);
+    while (m_running.load(std::memory_order_acquire) &&
+        m_writtenPos.load(std::memory_order_acquire) < target)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(LOG_IDLE_SLEEP_US));
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+// Log levels, ordered by severity.
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF   5
+
+// Statements below this level are removed by the preprocessor, arguments
+// included. Override with -DMOCK_LOG_LEVEL=LOG_LEVEL_DEBUG etc.
+#ifndef MOCK_LOG_LEVEL
+#define MOCK_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LogCategory
+{
+    LOG_CAT_MAIN,
+    LOG_CAT_TICK,
+    LOG_CAT_IPC,
+    LOG_CAT_CAPL,
+    LOG_CAT_COUNT
+};
+
+// Asynchronous logger. Producers format their message into a slot of a
+// bounded lock-free multi-producer ring and return; a background thread adds
+// timestamp, level and category and writes the lines out in batches, so the
+// tick thread never waits on console I/O. When the ring is full the message
+// is dropped and counted instead of blocking the caller.
+class AsyncLogger
+{
+public:
+    static const int SLOT_COUNT = 4096;     // must be a power of two
+    static const int MESSAGE_SIZE = 232;
+
+    static AsyncLogger& Instance();
+
+    // Categories can be muted at run time, all are enabled by default.
+    void SetCategoryEnabled(LogCategory category, bool enabled);
+    bool IsEnabled(LogCategory category) const
+    {
+        return (m_categoryMask.load(std::memory_order_relaxed) & (1u << category)) != 0;
+    }
+
+    void Log(int level, LogCategory category, const char* format, ...)
+#ifdef __GNUC__
+        __attribute__((format(printf, 4, 5)))
+#endif
+        ;
+
+    // Blocks until everything logged so far has been written.
+    void Flush();
+
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        int64_t timestampNs;
+        uint8_t level;
+        uint8_t category;
+        uint16_t length;
+        char message[MESSAGE_SIZE];
+    };
+
+    AsyncLogger();
+    ~AsyncLogger();
+    AsyncLogger(const AsyncLogger&);
+    AsyncLogger& operator=(const AsyncLogger&);
+
+    void run();
+    bool writePending();
+
+    Slot* m_slots;
+    std::atomic<uint64_t> m_enqueuePos;
+    uint64_t m_dequeuePos;                  // owned by the writer thread
+    std::atomic<uint64_t> m_writtenPos;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint32_t> m_categoryMask;
+    std::atomic<bool> m_running;
+    int64_t m_startNs;
+    std::thread m_writer;
+};
+
+#define MOCK_LOG(level, category, ...) \
+    do { \
+        AsyncLogger& mockLogger_ = AsyncLogger::Instance(); \
+        if (mockLogger_.IsEnabled(category)) \
+            mockLogger_.Log(level, category, __VA_ARGS__); \
+    } while (0)
+
+#if MOCK_LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(category, ...) MOCK_LOG(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) ((void)0)
+#endif
+
+#if MOCK_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, ...) MOCK_LOG(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if MOCK_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(category, ...) MOCK_LOG(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if MOCK_LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(category, ...) MOCK_LOG(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#else
+#define LOG_WARN(category, ...) ((void)0)
+#endif
+
+#if MOCK_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(category, ...) MOCK_LOG(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) ((void)0)
+#endif
@@ -0,0 +1,95 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+void LatencyHistogram::Add(const uint64_t* counts, uint64_t sum, uint64_t min, uint64_t max)
+{
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        m_counts[i] += counts[i];
+        m_count += counts[i];
+    }
+    m_sum += sum;
+    if (min < m_min)
+    {
+        m_min = min;
+    }
+    if (max > m_max)
+    {
+        m_max = max;
+    }
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    int magnitude = index / SUB_BUCKETS;
+    uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKETS);
+    if (magnitude == 0)
+    {
+        return sub;
+    }
+    // Bucket covers [(SUB_BUCKETS + sub) << (magnitude - 1), next bucket)
+    int shift = magnitude - 1;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * m_count + 0.5);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucketUpperBound(i);
+            return upper < m_max ? upper : m_max;
+        }
+    }
+    return m_max;
+}
+
+void LatencyHistogram::WriteJson(std::ostream& out) const
+{
+    out << "{\"count\":" << m_count
+        << ",\"min\":" << (m_count ? m_min : 0)
+        << ",\"max\":" << m_max
+        << ",\"mean\":" << (m_count ? m_sum / m_count : 0)
+        << ",\"p50\":" << Percentile(50.0)
+        << ",\"p90\":" << Percentile(90.0)
+        << ",\"p99\":" << Percentile(99.0)
+        << ",\"p999\":" << Percentile(99.9)
+        << ",\"buckets\":[";
+    bool first = true;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        if (m_counts[i] == 0)
+        {
+            continue;
+        }
+        out << (first ? "" : ",") << "[" << bucketUpperBound(i) << "," << m_counts[i] << "]";
+        first = false;
+    }
+    out << "]}";
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <ostream>
+#include <time.h>
+
+// Log-linear latency histogram in the style of HdrHistogram. Values are
+// nanoseconds; every power of two is split into SUB_BUCKETS linear buckets,
+// which bounds the relative error of a reported value to 1/SUB_BUCKETS.
+// Recording is a few integer operations and one counter increment.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAGNITUDES = 41;   // covers up to 2^44 ns (~4.9 h), larger values land in the last bucket
+    static const int BUCKET_COUNT = MAGNITUDES * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void Record(int64_t valueNs)
+    {
+        if (valueNs < 0)
+        {
+            valueNs = 0;
+        }
+        uint64_t value = static_cast<uint64_t>(valueNs);
+        m_counts[BucketIndex(value)]++;
+        m_count++;
+        m_sum += value;
+        if (value < m_min)
+        {
+            m_min = value;
+        }
+        if (value > m_max)
+        {
+            m_max = value;
+        }
+    }
+
+    void Reset();
+
+    // Adds values counted elsewhere in the bucket layout of BucketIndex(),
+    // e.g. by counters that several threads update.
+    void Add(const uint64_t* counts, uint64_t sum, uint64_t min, uint64_t max);
+
+    uint64_t Count() const { return m_count; }
+    uint64_t Sum() const { return m_sum; }
+    uint64_t Max() const { return m_max; }
+
+    // Upper bound of the bucket holding the given percentile (0..100).
+    uint64_t Percentile(double percentile) const;
+
+    // Writes one JSON object with summary values and the non-empty buckets.
+    void WriteJson(std::ostream& out) const;
+
+    // Monotonic timestamp in nanoseconds. CLOCK_MONOTONIC is served from the
+    // vDSO and backed by the TSC on x86, so a read costs a few tens of ns.
+    static int64_t Now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static int BucketIndex(uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return static_cast<int>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int magnitude = msb - SUB_BUCKET_BITS + 1;
+        if (magnitude >= MAGNITUDES)
+        {
+            return BUCKET_COUNT - 1;
+        }
+        int sub = static_cast<int>((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return magnitude * SUB_BUCKETS + sub;
+    }
+
+private:
+    static uint64_t bucketUpperBound(int index);
+
+    uint64_t m_counts[BUCKET_COUNT];
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
@@ -2,20 +2,55 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <string>
+#include <cstdlib>
+#include <atomic>
+#include <csignal>
 #include <poll.h>
 #include <unistd.h>
+#include "FMI2Interface/IPCFactory.h"
+#include "FMI2Interface/FMUUnixSocket.h"
+#include "MockTickScheduler.h"
+#include "MockTickStats.h"
+#include "AsyncLogger.h"
 
 extern bool fmi2DoStep(double communicationStepSize);
-extern void onPreStart();
-extern void onstart();
+extern bool onPreStart();
+extern bool reloadCaplDll();
+extern std::string caplDllPath;
+extern std::string replayTracePath;
+extern std::string busLoadConfigPath;
+extern std::string ethReplayPath;
+extern std::string flexraySchedulePath;
+extern std::string capturePath;
+extern bool virtualCanEnabled;
 extern void setParameter();
-extern bool fmi2DoStep(double communicationStepSize);
-extern void transactionofTxRxData();
+extern bool fmi2DoSteps(double communicationStepSize, int stepCount);
+extern void runCaplTick();
+extern int caplInstanceCount;
+extern int caplWorkerCount;
 extern bool init_SocketConn_FmuTick();
+extern std::unique_ptr<IBaseIPC> m_SILConIPCObject;
 extern void setReset();
 
 extern bool sim_reset;
 extern bool reset;
+extern int tickWindowDepth;
+extern IPC_TYPE tickIpcType;
+extern std::string tickIpcEndpoint;
+extern int tickIpcTimeoutMs;
+extern bool inBandReset;
+extern void printResetStatistics();
+extern void printCanInjectionStatistics();
+extern void closeFrameCapture();
+extern void dumpCaplFunctionHistograms(int tick, const char* reason);
+extern std::atomic<bool> runloop;
+extern bool drainStepWindow();
+
+int stepsPerFrame = 1;
+double communicationStepSize = 0.005;
+double realTimeFactor = 0.0; // <= 0 runs as fast as possible
+MockTickScheduler tickScheduler;
 
 std::mutex io_mutex;
 bool blockSendingTick = false;
@@ -44,21 +79,198 @@ void userCommandHandler()
     }
 }
 
-int main()
+static void parseArguments(int argc, char* argv[])
 {
-    onPreStart();
+    bool endpointGiven = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--tick-window" && i + 1 < argc)
+        {
+            tickWindowDepth = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ipc" && i + 1 < argc)
+        {
+            std::string type = argv[++i];
+            if (type == "shm")
+            {
+                tickIpcType = IPC_SHARED_MEM;
+            }
+            else if (type == "unix")
+            {
+                tickIpcType = IPC_UNIX;
+            }
+            else
+            {
+                tickIpcType = IPC;
+            }
+        }
+        else if (arg == "--ipc-endpoint" && i + 1 < argc)
+        {
+            tickIpcEndpoint = argv[++i];
+            endpointGiven = true;
+        }
+        else if (arg == "--ipc-timeout" && i + 1 < argc)
+        {
+            tickIpcTimeoutMs = std::atoi(argv[++i]);
+        }
+        else if (arg == "--inband-reset")
+        {
+            inBandReset = true;
+        }
+        else if (arg == "--rt-factor" && i + 1 < argc)
+        {
+            realTimeFactor = std::atof(argv[++i]);
+        }
+        else if (arg == "--capl-dll" && i + 1 < argc)
+        {
+            caplDllPath = argv[++i];
+        }
+        else if (arg == "--instances" && i + 1 < argc)
+        {
+            caplInstanceCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--capl-workers" && i + 1 < argc)
+        {
+            caplWorkerCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayTracePath = argv[++i];
+        }
+        else if (arg == "--eth-replay" && i + 1 < argc)
+        {
+            ethReplayPath = argv[++i];
+        }
+        else if (arg == "--flexray" && i + 1 < argc)
+        {
+            flexraySchedulePath = argv[++i];
+        }
+        else if (arg == "--busload" && i + 1 < argc)
+        {
+            busLoadConfigPath = argv[++i];
+        }
+        else if (arg == "--virtual-can")
+        {
+            virtualCanEnabled = true;
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+        {
+            capturePath = argv[++i];
+        }
+        else if (arg == "--hist-file" && i + 1 < argc)
+        {
+            tickHistogramFile = argv[++i];
+        }
+        else if (arg == "--hist-interval" && i + 1 < argc)
+        {
+            tickHistogramInterval = std::atoi(argv[++i]);
+        }
+        else if (arg == "--steps-per-frame" && i + 1 < argc)
+        {
+            stepsPerFrame = std::atoi(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "Ignoring unknown argument: " << arg << std::endl;
+        }
+    }
+#ifdef __linux__
+    // The default endpoint is a TCP port, which is no socket path
+    if (tickIpcType == IPC_UNIX && !endpointGiven)
+    {
+        tickIpcEndpoint = FMUUnix::DEFAULT_SOCKET_PATH;
+    }
+#endif
+}
+
+static void onStopSignal(int)
+{
+    runloop = false;
+}
+
+static std::atomic<bool> caplReloadRequested(false);
+
+static void onReloadSignal(int)
+{
+    caplReloadRequested = true;
+}
+
+int main(int argc, char* argv[])
+{
+    parseArguments(argc, argv);
+
+    struct sigaction stopAction = {};
+    stopAction.sa_handler = onStopSignal;
+    sigaction(SIGINT, &stopAction, nullptr);
+    sigaction(SIGTERM, &stopAction, nullptr);
+
+    // SIGHUP swaps in a rebuilt CAPL DLL without restarting the harness
+    struct sigaction reloadAction = {};
+    reloadAction.sa_handler = onReloadSignal;
+    sigaction(SIGHUP, &reloadAction, nullptr);
+
+    if (!onPreStart())
+    {
+        return 1;
+    }
     
-    init_SocketConn_FmuTick();
+    if (!init_SocketConn_FmuTick())
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "Connecting to the SIL controller failed: %s",
+                  m_SILConIPCObject ? m_SILConIPCObject->getErrorDescription().c_str() : "transport not available");
+        AsyncLogger::Instance().Flush();
+        return 1;
+    }
     
     // std::thread t2(setReset);
     // t2.detach();
     
-    for(;;)
+    tickScheduler.Configure(communicationStepSize * (stepsPerFrame > 1 ? stepsPerFrame : 1), realTimeFactor);
+    tickScheduler.Start();
+
+    int loopCount = 0;
+    while (runloop)
     {
-        fmi2DoStep(0.005);
-        onstart();
-        transactionofTxRxData();
+        tickScheduler.WaitForNextTick();
+        if (caplReloadRequested.exchange(false) && !reloadCaplDll())
+        {
+            break;
+        }
+        int64_t tickStart = LatencyHistogram::Now();
+        if (!fmi2DoSteps(communicationStepSize, stepsPerFrame))
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "Stopping: step exchange with the SIL controller failed");
+            break;
+        }
+        int64_t caplStart = LatencyHistogram::Now();
+        // A batch advances the controller by several steps at once, CAPL
+        // still ticks once per step so timers and bus traffic keep step
+        // resolution.
+        for (int step = 0; step < (stepsPerFrame > 1 ? stepsPerFrame : 1); ++step)
+        {
+            runCaplTick();
+        }
+        recordTickPhase(TICK_PHASE_CAPL, caplStart);
+        recordTickPhase(TICK_PHASE_TOTAL, tickStart);
+
+        if (tickHistogramInterval > 0 && ++loopCount % tickHistogramInterval == 0)
+        {
+            dumpTickPhaseHistograms(loopCount, "periodic");
+        }
     }
     
+    if (!runloop)
+    {
+        // Stopped on request, collect the acks of the steps still in flight
+        drainStepWindow();
+    }
+    AsyncLogger::Instance().Flush();
+    dumpTickPhaseHistograms(loopCount, "exit");
+    dumpCaplFunctionHistograms(loopCount, "exit");
+    printResetStatistics();
+    printCanInjectionStatistics();
+    closeFrameCapture();
+    tickScheduler.PrintStatistics(std::cout);
     return 0;
 }
\ No newline at end of file